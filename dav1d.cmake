@@ -0,0 +1,31 @@
+include (ExternalProject)
+
+find_package (Threads REQUIRED)
+
+set (DAV1D_GIT            "https://code.videolan.org/videolan/dav1d.git" )
+
+set(DAV1D_PREFIX ${PROJECT_BINARY_DIR}/dav1d)
+
+# dav1d is built with meson, so meson and ninja must be available in PATH (found in CMakeLists.txt)
+ExternalProject_Add (dav1d_dependency
+    PREFIX ${DAV1D_PREFIX}
+    GIT_REPOSITORY ${DAV1D_GIT}
+    SOURCE_DIR ${DAV1D_PREFIX}/src
+    BINARY_DIR ${DAV1D_PREFIX}/build
+    STAMP_DIR ${DAV1D_PREFIX}/stamp
+    GIT_TAG "1.5.1"
+    GIT_SHALLOW TRUE
+    GIT_PROGRESS TRUE
+    UPDATE_COMMAND  ""
+    INSTALL_COMMAND ""
+    CONFIGURE_COMMAND ${GLEED_MESON_EXECUTABLE} setup ${DAV1D_PREFIX}/build ${DAV1D_PREFIX}/src --buildtype=release --default-library=static -Denable_tools=false -Denable_tests=false
+    BUILD_COMMAND ${GLEED_NINJA_EXECUTABLE} -C ${DAV1D_PREFIX}/build
+    BUILD_BYPRODUCTS ${DAV1D_PREFIX}/build/src/libdav1d.a
+)
+
+add_library(dav1d STATIC IMPORTED)
+set_target_properties(dav1d PROPERTIES
+    IMPORTED_LOCATION ${DAV1D_PREFIX}/build/src/libdav1d.a
+    INTERFACE_INCLUDE_DIRECTORIES "${DAV1D_PREFIX}/src/include;${DAV1D_PREFIX}/build/include/dav1d"
+    INTERFACE_LINK_LIBRARIES Threads::Threads
+)
@@ -72,6 +72,7 @@ extern "C"
         GLEED_CODEC_TYPE_VP9 = 2,     /**< VP9 video codec */
         GLEED_CODEC_TYPE_VORBIS = 3,  /**< Vorbis audio codec */
         GLEED_CODEC_TYPE_OPUS = 4,    /**< Opus audio codec */
+        GLEED_CODEC_TYPE_AV1 = 5,     /**< AV1 video codec (only if built with GLEED_ENABLE_AV1) */
     } GleedMovieCodecType;
 
     /**
@@ -169,6 +170,81 @@ extern "C"
      */
     extern GleedMovie *GleedOpenIO(SDL_IOStream *io);
 
+    /**
+     * Asynchronous movie open operation
+     *
+     * Handle of a movie being opened in background with GleedOpenAsync.
+     *
+     * Opaque structure, do not modify its members directly.
+     */
+    typedef struct GleedAsyncOpen GleedAsyncOpen;
+
+    /**
+     * Asynchronous movie open status
+     */
+    typedef enum
+    {
+        GLEED_ASYNC_OPEN_PENDING = 0, /**< File is still being loaded or parsed */
+        GLEED_ASYNC_OPEN_DONE = 1,    /**< Movie is ready, call GleedFinishOpenAsync to obtain it */
+        GLEED_ASYNC_OPEN_FAILED = 2,  /**< Open failed, call GleedFinishOpenAsync to get the error */
+    } GleedAsyncOpenStatus;
+
+    /**
+     * Open movie (.webm) file asynchronously
+     *
+     * Starts opening the movie in background and returns immediately, so the calling thread can keep rendering
+     * (e.g. a loading animation) meanwhile. Any number of movies may be opened concurrently.
+     *
+     * The file is parsed on a worker thread, which reads only the parts the parser needs, in chunks, with SDL async I/O.
+     * The resulting movie then reads frames from the file on demand like one from GleedOpen, so opening many large
+     * movies at once doesn't keep them in memory, and GleedPreloadVideoStream works as usual.
+     *
+     * Poll the operation with GleedGetAsyncOpenStatus and call GleedFinishOpenAsync to obtain the movie.
+     * The movie must be freed with GleedFreeMovie as usual, the IO stream is always closed in that case.
+     *
+     * \param file Path to .webm file
+     *
+     * \returns Async open handle, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedAsyncOpen *GleedOpenAsync(const char *file);
+
+    /**
+     * Open movie (.webm) file asynchronously and prepare it for playback
+     *
+     * Same as GleedOpenAsync, but the worker thread also calls GleedPrepareMovie, so decoders are initialized
+     * and the first frames are decoded by the time the operation is done.
+     *
+     * \param file Path to .webm file
+     *
+     * \returns Async open handle, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedAsyncOpen *GleedOpenAsyncPrepared(const char *file);
+
+    /**
+     * Get status of an asynchronous movie open
+     *
+     * This function never blocks.
+     *
+     * \param op Async open handle from GleedOpenAsync
+     *
+     * \returns Current status of the operation.
+     */
+    extern GleedAsyncOpenStatus GleedGetAsyncOpenStatus(GleedAsyncOpen *op);
+
+    /**
+     * Finish an asynchronous movie open
+     *
+     * Returns the opened movie and releases the handle, which is no longer valid after this call.
+     * Must be called exactly once for each GleedOpenAsync handle, even if you are no longer interested in the movie.
+     *
+     * If the operation is still pending, this function blocks until it completes.
+     *
+     * \param op Async open handle from GleedOpenAsync
+     *
+     * \returns Pointer to prepared GleedMovie, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedMovie *GleedFinishOpenAsync(GleedAsyncOpen *op);
+
     /**
      * Free (release) a movie instance
      *
@@ -181,6 +257,74 @@ extern "C"
      */
     extern void GleedFreeMovie(GleedMovie *movie, bool closeio);
 
+    /**
+     * Prepare the movie for playback
+     *
+     * Decoders are created lazily, so without this call the first decode pays for decoder initialization,
+     * buffer allocations and a keyframe decode at once, which shows up as a hitch at the start of playback.
+     *
+     * This function does all of it upfront: allocates read buffers for the largest frames of selected tracks,
+     * initializes decoders and decodes the first video frame and audio packet. The following GleedDecodeVideoFrame
+     * and GleedDecodeAudioFrame calls return these frames without any work, so GleedMoviePlayer starts instantly.
+     *
+     * Can be called on a worker thread, as long as the movie is not used elsewhere meanwhile.
+     * GleedOpenAsyncPrepared does it for you.
+     *
+     * \param movie GleedMovie instance with selected tracks, at its first frame
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedPrepareMovie(GleedMovie *movie);
+
+    /**
+     * Free all idle decoders
+     *
+     * Decoders of freed (or reopened) movies are reset and kept in a process-wide pool, so the next movie
+     * using the same codec and parameters does not pay for decoder construction again (e.g. starting VP9 or AV1
+     * decoder threads, or building Vorbis synthesis from setup headers). Up to 8 idle decoders are kept.
+     *
+     * Call it when you no longer expect to open movies, e.g. before shutting down, to release their memory and threads.
+     * Decoders used by open movies are not affected.
+     */
+    extern void GleedClearDecoderPool(void);
+
+    /**
+     * Set number of threads used for color conversion of large video frames
+     *
+     * Frames of 720p and above are converted in horizontal slices, spread across a small process-wide pool
+     * of worker threads and the decoding thread itself. Smaller frames are always converted on the decoding thread,
+     * as waking up workers would cost more than it saves.
+     *
+     * Workers are started on first use. May be called at any time: a conversion already running finishes on the old workers,
+     * and conversions started meanwhile run on the decoding thread alone, without waiting, until the new workers are up.
+     * This call itself waits for running conversions to finish and for the old workers to exit.
+     *
+     * \param count Number of threads including the decoding one, 0 to use one per logical CPU core (default),
+     * 1 to convert on the decoding thread only and stop the workers
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedSetConversionThreads(int count);
+
+    /**
+     * Reopen the movie with another file
+     *
+     * Parses a new .webm file into an existing movie instance, so switching clips does not have to
+     * free and create everything again. Decoders are kept when the new file uses the same codecs
+     * (and the same audio setup), frame buffers and surfaces are kept when sizes allow it.
+     *
+     * Movie is rewound to the start and first video and audio tracks are selected, as with GleedOpenIO.
+     * If the new file fails to parse, the movie is left untouched and still plays the old file.
+     *
+     * If you use the movie in a GleedMoviePlayer, call GleedSetPlayerMovie afterwards to restart the player.
+     *
+     * \param movie GleedMovie instance
+     * \param io SDL IO stream for the new .webm file, owned by the movie from now on like with GleedOpenIO
+     * \param closeio If true, will close the SDL IO stream of the old file
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedReopen(GleedMovie *movie, SDL_IOStream *io, bool closeio);
+
     /**
      * Get a track from movie
      *
@@ -255,9 +399,10 @@ extern "C"
      * It does not perform any strict checks on the texture origin, so you may provide even
      * your custom texture, but it must be compatible with the video format of the movie.
      *
-     * During this operation, texture will be locked.
+     * If the texture has the same size as the video frame, pixels are uploaded directly with SDL_UpdateTexture,
+     * without any intermediate blitting - this is the fastest path and the one used for textures from GleedCreatePlaybackTexture.
      *
-     * A texture of different size may be provided, then default SDL blitting rules will be applied (basically stretching).
+     * A texture of different size may be provided, then it will be locked and default SDL blitting rules will be applied.
      *
      * This function will result in error if there is no decoded video frame available.
      *
@@ -268,6 +413,101 @@ extern "C"
      */
     extern bool GleedUpdatePlaybackTexture(GleedMovie *movie, SDL_Texture *texture);
 
+    /**
+     * Enable or disable dirty rectangle updates
+     *
+     * Screen recordings and UI tutorial videos often change only a small region between frames.
+     * When enabled, each decoded frame is split into 16x16 pixel blocks, which are hashed and compared with the previous frame,
+     * and only changed (dirty) regions are converted into the video frame surface.
+     *
+     * GleedUpdatePlaybackTexture will then upload only regions changed since its previous call, so the texture must
+     * keep holding the frames of this movie - do not update it from other sources in between.
+     *
+     * For regular movies, where almost the whole picture changes every frame, this only adds the hashing overhead,
+     * so it's disabled by default.
+     *
+     * \param movie GleedMovie instance
+     * \param enabled True to enable dirty rectangle updates, false to disable
+     */
+    extern void GleedSetDirtyRectUpdates(GleedMovie *movie, bool enabled);
+
+    /**
+     * Enable or disable pipelined video decoding
+     *
+     * When enabled, each GleedDecodeVideoFrame call decodes the next frame ahead on a worker thread,
+     * while the current one (decoded by the previous call) is converted. Decoding and conversion are the two
+     * most expensive parts of each frame, so this raises throughput of high resolution playback,
+     * at a cost of keeping one more decoded frame in memory. VP9 and AV1 frames are kept by their decoders,
+     * VP8 frames are copied, as VP8 decoder reuses its frame buffers.
+     *
+     * Both stages share the worker pool set up by GleedSetConversionThreads, so large frames are still converted
+     * in slices by the workers left idle by decoding.
+     *
+     * Frame decoded ahead is used only if the next decode call continues with the following frame,
+     * e.g. seeking drops it. Disabled by default.
+     *
+     * \param movie GleedMovie instance
+     * \param enabled True to enable pipelined decoding, false to disable
+     */
+    extern void GleedSetPipelinedDecoding(GleedMovie *movie, bool enabled);
+
+    /**
+     * Video decoder speed and quality settings
+     *
+     * All options are off (zeroed) by default, which gives decoders' own defaults.
+     */
+    typedef struct
+    {
+        bool vp8_postproc;        /**< VP8 deblocking and demacroblocking postprocessing, smoother low bitrate movies at some CPU cost */
+        int vp8_deblocking_level; /**< Strength of VP8 postprocessing, 0 to 16 */
+        bool skip_loop_filter;    /**< Skip VP9 loop filter and AV1 in-loop filters, faster but with visible blocking artifacts */
+        int vp9_threads;          /**< Number of VP9 decoder threads, 0 for decoder default (single thread) */
+        bool vp9_row_mt;          /**< Decode VP9 rows in parallel, only effective with more than one thread */
+        bool vp9_loop_filter_opt; /**< Faster VP9 loop filter (libvpx lpf_opt) */
+    } GleedVideoDecoderOptions;
+
+    /**
+     * Set video decoder options
+     *
+     * On low-end CPUs you may trade some picture quality for a sustained frame rate, e.g. by skipping the loop filter.
+     *
+     * Postprocessing strength and VP9 loop filter skip apply from the next decoded frame. Other options
+     * (VP8 postprocessing on or off, VP9 threads, AV1 in-loop filters) need a new decoder, which is created
+     * at the next keyframe, as a decoder without reference frames can only start there.
+     *
+     * Note that skipped loop filter also affects reference frames, so artifacts accumulate until the next keyframe.
+     *
+     * \param movie GleedMovie instance
+     * \param options Decoder options, copied into the movie
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedSetVideoDecoderOptions(GleedMovie *movie, const GleedVideoDecoderOptions *options);
+
+    /**
+     * Get video decoder options
+     *
+     * \param movie GleedMovie instance
+     * \param options Pointer to store current decoder options
+     */
+    extern void GleedGetVideoDecoderOptions(GleedMovie *movie, GleedVideoDecoderOptions *options);
+
+    /**
+     * Get dirty rectangles of the last decoded video frame
+     *
+     * Returns regions of the video frame surface which were changed by the last GleedDecodeVideoFrame call,
+     * if dirty rectangle updates are enabled with GleedSetDirtyRectUpdates.
+     *
+     * You may use them to update only parts of your own textures or buffers.
+     *
+     * The array is valid until the next call to GleedDecodeVideoFrame.
+     *
+     * \param movie GleedMovie instance
+     * \param count Pointer to store the number of rectangles, or NULL if not needed
+     *
+     * \returns Array of dirty rectangles, or NULL if dirty rectangle updates are disabled or no frame was decoded yet.
+     */
+    extern const SDL_Rect *GleedGetVideoFrameDirtyRects(GleedMovie *movie, int *count);
+
     /**
      * Check if there is a next video frame available
      *
@@ -290,6 +530,65 @@ extern "C"
      */
     extern bool GleedDecodeVideoFrame(GleedMovie *movie);
 
+    /**
+     * Decodes current video frame of the movie directly into your own memory
+     *
+     * Works like GleedDecodeVideoFrame, but the converted frame is written straight into given pixels
+     * (e.g. a locked texture, shared memory or encoder input) instead of the video frame surface,
+     * saving a full frame copy if you do not render with SDL_Texture.
+     *
+     * Target must be large enough to hold the whole video frame (see GleedGetVideoSize) in given format.
+     * Any format supported by SDL_ConvertPixelsAndColorspace can be used, including YUV ones.
+     *
+     * The video frame surface is not updated by this call and keeps the previously decoded frame.
+     *
+     * \param movie GleedMovie instance with configured video track
+     * \param pixels Target pixels, owned by you
+     * \param pitch Target pitch (length of a row) in bytes
+     * \param format Target pixel format
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedDecodeVideoFrameInto(GleedMovie *movie, void *pixels, int pitch, SDL_PixelFormat format);
+
+    /**
+     * Get decoded YUV planes of the current video frame
+     *
+     * Gives direct access to the planes produced by the video decoder, without any conversion or copy.
+     * This is the cheapest way to get frames if you upload YUV to the GPU yourself, analyze or encode them.
+     *
+     * Planes are owned by the decoder and are valid only until the next GleedDecodeVideoFrame call.
+     * Chroma planes are subsampled 4:2:0, so they have (width + 1) / 2 columns and (height + 1) / 2 rows.
+     *
+     * If you only need planes, also disable RGB conversion with GleedSetVideoFrameConversion.
+     *
+     * \param movie GleedMovie instance with decoded video frame
+     * \param planes Array to store pointers to Y, U and V planes
+     * \param strides Array to store stride (length of a row in bytes) of each plane
+     * \param format Pointer to store the planar format (SDL_PIXELFORMAT_IYUV or SDL_PIXELFORMAT_YV12), or NULL if not needed
+     * \param colorspace Pointer to store the YUV colorspace (matrix and range) of the frame, or NULL if not needed
+     * \param width Pointer to store the width of the Y plane in pixels, or NULL if not needed
+     * \param height Pointer to store the height of the Y plane in pixels, or NULL if not needed
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedGetVideoFramePlanes(GleedMovie *movie, const Uint8 *planes[3], int strides[3], SDL_PixelFormat *format, SDL_Colorspace *colorspace, int *width, int *height);
+
+    /**
+     * Enable or disable conversion of decoded video frames to RGB
+     *
+     * Conversion is enabled by default. When disabled, GleedDecodeVideoFrame only decodes the frame,
+     * and it can be accessed with GleedGetVideoFramePlanes - the video frame surface and playback textures
+     * are not updated anymore. GleedMoviePlayer keeps its textures and atlas tile on the last converted frame
+     * until conversion is enabled again.
+     *
+     * GleedDecodeVideoFrameInto always converts the frame regardless of this setting.
+     *
+     * \param movie GleedMovie instance
+     * \param enabled True to convert frames to RGB, false to only decode them
+     */
+    extern void GleedSetVideoFrameConversion(GleedMovie *movie, bool enabled);
+
     /**
      * Get the current video frame surface
      *
@@ -402,15 +701,38 @@ extern "C"
      */
     extern const SDL_AudioSpec *GleedGetAudioSpec(GleedMovie *movie);
 
+    /**
+     * Set the frequency Opus audio is decoded at
+     *
+     * libopus can decode natively at 8000, 12000, 16000, 24000 and 48000 Hz. Decoding at the output device frequency
+     * removes resampling from the audio path, and decoding background or preview clips at a lower frequency costs less CPU.
+     *
+     * GleedSetPlayerAudioOutput and GleedAddPlayerToMixer set it to the device frequency automatically if it's supported
+     * and the player has not started decoding audio yet. Otherwise the decoder is left as is, and the audio stream resamples.
+     * Players apply the output frequency again whenever a movie starts over.
+     *
+     * Audio spec of the movie changes accordingly, so call this before creating audio streams for the movie.
+     * Has no effect on Vorbis tracks.
+     *
+     * \param movie GleedMovie instance
+     * \param frequency One of the supported frequencies, or 0 to decode at the track frequency (default)
+     *
+     * \returns True on success, false on error (unsupported frequency). Call GleedGetError to get the error message.
+     */
+    extern bool GleedSetOpusDecodeFrequency(GleedMovie *movie, int frequency);
+
     /**
      * Seek to a specific frame in the movie
      *
      * This function allows you to seek to a specific video frame in the movie.
-     * The seek may be not precise, as it will seek to the nearest keyframe.
+     * The seek may be not precise, as it will seek to the nearest preceding keyframe,
+     * since decoding cannot start from any other frame.
      *
-     * If both audio and video tracks are present, it will seek to the nearest keyframe of the video track
+     * If both audio and video tracks are present, it will seek to the nearest preceding keyframe of the video track
      * and sync the audio track to the video track.
      *
+     * Frame numbers include invisible frames, see GleedGetTotalVideoFrames.
+     *
      * \param movie GleedMovie instance
      * \param frame Frame number to seek to
      */
@@ -431,6 +753,10 @@ extern "C"
     /**
      * Get the total number of video frames in the movie
      *
+     * Frame numbers count every video frame stored in the file, including invisible ones (e.g. VP8/VP9 alt-ref frames),
+     * which are only decoded as references for the following frames and are never shown.
+     * So the number of pictures shown during playback may be lower than this.
+     *
      * \param movie GleedMovie instance
      * \returns Total number of video frames in the movie, or 0 on error.
      */
@@ -439,7 +765,9 @@ extern "C"
     /**
      * Get the current video frame number
      *
-     * This number is incremented with each call to GleedNextVideoFrame.
+     * This number is incremented with each call to GleedNextVideoFrame. GleedDecodeVideoFrame moves it past
+     * invisible frames preceding the decoded picture, so it may grow by more than one per picture,
+     * see GleedGetTotalVideoFrames.
      *
      * \param movie GleedMovie instance
      * \returns Current video frame number, or 0 on error.
@@ -465,6 +793,8 @@ extern "C"
      *
      * This function returns the last error message that occurred during the last operation.
      *
+     * Errors are stored per thread, so it returns the last error of the calling thread.
+     *
      * Currently, error is not cleared after retrieval or successful operation.
      *
      * \returns Error message string, or NULL if there was no error.
@@ -488,6 +818,131 @@ extern "C"
      */
     extern bool GleedPreloadAudioStream(GleedMovie *movie);
 
+    /**
+     * Preload video stream in a sliding window
+     *
+     * Unlike audio, video tracks are usually too big to be kept in memory completely, so only a window of encoded
+     * video frames ahead of the current one is kept. When the current frame is outside of the window,
+     * the window is refilled with a single sequential read, instead of a seek and a read per frame.
+     * Audio frames interleaved with video ones in the file are read from the window too.
+     *
+     * For movies opened from a file path (GleedOpen, GleedOpenAsync), the following window is read in background
+     * with SDL async I/O once about half of the current one is played, so decoding doesn't wait for the disk.
+     * Movies opened from a stream refill the window synchronously. Two windows are kept in memory then.
+     *
+     * This is useful for cinematics played from slow storage (optical discs, network drives, HDDs),
+     * and memory stays bounded by the bitrate of the movie multiplied by window duration.
+     *
+     * \param movie GleedMovie instance with configured video track
+     * \param window_ms Duration of video to keep in memory in milliseconds, or 0 to disable preloading and free the window
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedPreloadVideoStream(GleedMovie *movie, Uint64 window_ms);
+
+    /**
+     * Encoded movie packet
+     *
+     * Represents a single encoded (compressed) frame of the selected video or audio track, read from the file.
+     *
+     * Packets are obtained with GleedReadPacket. Their data buffers come from a pool owned by the movie,
+     * so each packet must be either returned with GleedReleasePacket or handed over to decoding with GleedQueuePacket.
+     */
+    typedef struct
+    {
+        GleedMovieTrackType type; /**< Type of the track the packet belongs to */
+        int track;                /**< Index of the track the packet belongs to */
+        Uint32 frame;             /**< Index of the frame within its track */
+        Uint64 timecode_ms;       /**< Presentation time of the frame in milliseconds */
+        bool key_frame;           /**< Is this packet a keyframe */
+        const Uint8 *data;        /**< Encoded frame data */
+        Uint32 size;              /**< Size of encoded frame data in bytes */
+        void *internal;           /**< Internal pool handle, do not modify */
+    } GleedMoviePacket;
+
+    /**
+     * Read next encoded packet of the movie
+     *
+     * Yields encoded packets of the selected video and audio tracks in the order they are stored in the file,
+     * so the file is read sequentially. Reading position is independent from decoding position,
+     * and is reset to the current decoding position on GleedSeekFrame.
+     *
+     * This is useful if you want to process encoded data yourself, or to separate file reading from decoding -
+     * e.g. an IO thread can read packets and pass them to GleedQueuePacket, while another thread decodes them
+     * with GleedDecodeVideoFrame and GleedDecodeAudioFrame, which then take data from that queue instead of reading the file.
+     *
+     * Reading packets and decoding may happen on different threads,
+     * but each of them must not be called from more than one thread at a time.
+     *
+     * \param movie GleedMovie instance
+     * \param packet Pointer to packet structure to fill
+     *
+     * \returns True on success, false if there are no more packets or on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedReadPacket(GleedMovie *movie, GleedMoviePacket *packet);
+
+    /**
+     * Release a packet
+     *
+     * Returns packet buffer to the movie pool, so it can be reused by next GleedReadPacket calls.
+     * All packets must be released before the movie is freed.
+     *
+     * \param movie GleedMovie instance the packet was read from
+     * \param packet Packet to release, it's zeroed after this call
+     */
+    extern void GleedReleasePacket(GleedMovie *movie, GleedMoviePacket *packet);
+
+    /**
+     * Queue a packet for decoding
+     *
+     * Hands the packet over to the movie decoding queue: GleedDecodeVideoFrame and GleedDecodeAudioFrame will use
+     * queued packets for the current frame instead of reading it from the file. Packets for frames
+     * which are already behind the decoding position are dropped automatically.
+     *
+     * Ownership of the packet passes to the movie, do not release it after this call.
+     *
+     * \param movie GleedMovie instance the packet was read from
+     * \param packet Packet to queue, it's zeroed after this call
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedQueuePacket(GleedMovie *movie, GleedMoviePacket *packet);
+
+    /**
+     * Extract a clip of the movie into a new WebM file
+     *
+     * Encoded frames of the selected video and audio tracks are copied as-is (without decoding and re-encoding),
+     * so this is fast and lossless. Only the new segment headers, clusters and cues are written.
+     *
+     * As video can only start from a keyframe, the clip actually begins at the last keyframe before start_ms,
+     * so it may be a bit longer than requested. Timecodes in the clip are shifted to start at zero.
+     *
+     * \param movie GleedMovie instance with selected tracks
+     * \param output SDL IO stream to write the clip to, must be seekable
+     * \param start_ms Clip start time in milliseconds
+     * \param end_ms Clip end time in milliseconds (exclusive)
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedExtractClip(GleedMovie *movie, SDL_IOStream *output, Uint64 start_ms, Uint64 end_ms);
+
+    /**
+     * Remux the movie into a new WebM file optimized for playback
+     *
+     * Copies all frames of the selected video and audio tracks into a new file (without re-encoding) which:
+     * - has Cues placed before Clusters, so seek points are known right after parsing the headers
+     * - has correct keyframe flags, taken from the codec bitstream instead of the original file
+     * - starts every Cluster at a video keyframe, and has a cue point for each of them
+     *
+     * This is intended to be done once, when preparing assets, e.g. with gleed_remux tool.
+     * Whole output is built in memory first, so expect memory usage of about the movie size.
+     *
+     * \param movie GleedMovie instance with selected tracks
+     * \param output SDL IO stream to write the new file to, must be seekable
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedRemuxForPlayback(GleedMovie *movie, SDL_IOStream *output);
+
     /*
         Movie player structure
 
@@ -545,6 +1000,83 @@ extern "C"
      */
     extern GleedMoviePlayer *GleedCreatePlayerFromIO(SDL_IOStream *io);
 
+    /**
+     * Set the movie played by the player
+     *
+     * Restarts the player with another movie (or the same movie reopened with GleedReopen) from the beginning,
+     * keeping its output textures, audio output and buffers. Previous movie is NOT freed,
+     * unless it was opened by the player from its playlist.
+     *
+     * Playlist is not affected: its next movie still starts once the new movie ends.
+     *
+     * \param player GleedMoviePlayer instance
+     * \param mov GleedMovie instance to play
+     */
+    extern void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov);
+
+    /**
+     * Add a movie file to the player playlist
+     *
+     * Playlist movies are played one after another once the current movie ends. The next movie is opened, indexed
+     * and its first video frame and audio samples are decoded on a worker thread while the current one plays,
+     * so the switch happens exactly at the end time of the current movie without stalling the update.
+     * If the worker has not finished yet by then, GleedUpdatePlayer waits for it.
+     *
+     * Audio of the next movie is queued right after the previous one, without clearing the output stream.
+     * Movies opened from the playlist are owned and freed by the player.
+     * When using output textures, all movies must have the same video size.
+     *
+     * \param player GleedMoviePlayer instance
+     * \param file Path to the .webm file, copied by the player
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedAddPlayerPlaylistFile(GleedMoviePlayer *player, const char *file);
+
+    /**
+     * Set if the playlist starts over after its last movie
+     *
+     * \param player GleedMoviePlayer instance
+     * \param loop True to loop the playlist, false to finish after its last movie (default)
+     */
+    extern void GleedSetPlayerPlaylistLoop(GleedMoviePlayer *player, bool loop);
+
+    /**
+     * Remove all movies from the player playlist
+     *
+     * Waits for a pending preload and frees the preloaded movie. Current movie keeps playing.
+     *
+     * \param player GleedMoviePlayer instance
+     */
+    extern void GleedClearPlayerPlaylist(GleedMoviePlayer *player);
+
+    /**
+     * Enable or disable adaptive playback quality
+     *
+     * When enabled, the player measures how long decoding a frame takes compared to the interval between frames.
+     * If frames keep running late, it lowers quality in steps:
+     *
+     * 1. VP9 loop filter and AV1 in-loop filters are skipped, VP8 postprocessing is turned off.
+     * 2. Frames which are superseded by another frame within the same update are decoded, but not converted.
+     *
+     * Quality is restored step by step when there is enough headroom again, so the same build plays smoothly
+     * on different hardware without per-device tuning. AV1 filter changes take effect at the next keyframe.
+     *
+     * Set movie decoder options with GleedSetVideoDecoderOptions before enabling it, they are used as full quality.
+     *
+     * \param player GleedMoviePlayer instance
+     * \param enabled True to enable adaptive quality, false to disable it and restore full quality (default)
+     */
+    extern void GleedSetPlayerAdaptiveQuality(GleedMoviePlayer *player, bool enabled);
+
+    /**
+     * Get current quality level of adaptive playback quality
+     *
+     * \param player GleedMoviePlayer instance
+     * \returns 0 for full quality, or the number of quality reduction steps applied (up to 2)
+     */
+    extern int GleedGetPlayerQualityLevel(GleedMoviePlayer *player);
+
     /**
      * Set player audio output device
      *
@@ -562,6 +1094,8 @@ extern "C"
      * If you want to stop audio output, you may pass 0 as the device id.
      * This will destroy the audio stream (if it was present) and stop automatic audio output.
      *
+     * If the player was added to a GleedAudioMixer, it's removed from it first.
+     *
      * \param player GleedMoviePlayer instance
      * \param dev SDL_AudioDeviceID of the opened audio device to output audio to
      *
@@ -590,6 +1124,49 @@ extern "C"
         GleedMoviePlayer *player,
         SDL_Texture *texture);
 
+/**
+ * Maximum number of output textures the player can rotate between
+ */
+#define GLEED_PLAYER_MAX_OUTPUT_TEXTURES 3
+
+    /**
+     * Set multiple player video output textures (double or triple buffering)
+     *
+     * Works like GleedSetPlayerVideoOutputTexture, but the player will rotate between the given textures,
+     * uploading each new video frame into the next one. The texture with the latest frame can be obtained
+     * with GleedGetPlayerVideoOutputTexture and should be the one you render.
+     *
+     * Because the texture which is presented right now is never locked or updated by the next upload,
+     * this avoids stalls on GPU drivers that are still reading the previous frame.
+     *
+     * All textures must be compatible with the video format, so it's recommended to create each of them with GleedCreatePlaybackTexture.
+     * The player does not take ownership of the textures.
+     *
+     * Passing NULL or 0 as count disables automatic texture update.
+     *
+     * \param player GleedMoviePlayer instance
+     * \param textures Array of SDL_Texture instances to rotate between
+     * \param count Number of textures in the array, from 1 to GLEED_PLAYER_MAX_OUTPUT_TEXTURES
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedSetPlayerVideoOutputTextures(
+        GleedMoviePlayer *player,
+        SDL_Texture **textures,
+        int count);
+
+    /**
+     * Get the player video output texture containing the latest frame
+     *
+     * When multiple output textures are set with GleedSetPlayerVideoOutputTextures, this returns the one
+     * which was updated last and is ready for rendering. With a single output texture, it's always that texture.
+     *
+     * \param player GleedMoviePlayer instance
+     *
+     * \returns SDL_Texture to render, or NULL if no output textures are set or no frame was uploaded into them yet.
+     */
+    extern SDL_Texture *GleedGetPlayerVideoOutputTexture(GleedMoviePlayer *player);
+
     /*
         Enum for player update result
     */
@@ -787,12 +1364,258 @@ extern "C"
      */
     extern void GleedSetPlayerVideoEnabled(GleedMoviePlayer *player, bool enabled);
 
+    /**
+        Video atlas structure
+
+        Video atlas is one big streaming texture shared by many GleedMoviePlayer instances,
+        each of them occupying its own sub-rectangle (tile) of the texture.
+
+        It's intended for video walls and similar cases with many small animated tiles -
+        new frames of all players are gathered and uploaded to the GPU together in each GleedUpdateVideoAtlas call,
+        and since all tiles live in the same texture, SDL_Renderer can batch their draw calls.
+
+        Video atlas can be created with GleedCreateVideoAtlas() and must be freed with GleedFreeVideoAtlas().
+
+        Opaque structure, do not modify its members directly.
+    */
+    typedef struct GleedVideoAtlas GleedVideoAtlas;
+
+    /**
+     * Create a video atlas
+     *
+     * Creates a SDL_PIXELFORMAT_RGB24 streaming texture of given size, owned by the atlas.
+     *
+     * \param renderer SDL_Renderer instance to create the atlas texture for
+     * \param w Atlas texture width in pixels
+     * \param h Atlas texture height in pixels
+     *
+     * \returns Pointer to the atlas instance, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedVideoAtlas *GleedCreateVideoAtlas(SDL_Renderer *renderer, int w, int h);
+
+    /**
+     * Add a player to the video atlas
+     *
+     * Allocates a tile of the player's video size inside the atlas, which will receive player video frames
+     * on each GleedUpdateVideoAtlas call. Tiles are packed left to right, top to bottom, in order of adding.
+     *
+     * Player must have a video track. You don't need to set an output texture for the player.
+     *
+     * Player must be removed from the atlas with GleedRemovePlayerFromAtlas before it's freed.
+     *
+     * \param atlas GleedVideoAtlas instance
+     * \param player GleedMoviePlayer instance
+     * \param rect Pointer to store the tile rectangle inside the atlas texture (use it as source rect for rendering), or NULL if not needed
+     *
+     * \returns True on success, false on error (for example if there is no free space left). Call GleedGetError to get the error message.
+     */
+    extern bool GleedAddPlayerToAtlas(GleedVideoAtlas *atlas, GleedMoviePlayer *player, SDL_Rect *rect);
+
+    /**
+     * Remove a player from the video atlas
+     *
+     * The tile will no longer be updated. Its space is not reused by the next added players.
+     *
+     * \param atlas GleedVideoAtlas instance
+     * \param player GleedMoviePlayer instance
+     */
+    extern void GleedRemovePlayerFromAtlas(GleedVideoAtlas *atlas, GleedMoviePlayer *player);
+
+    /**
+     * Update the video atlas
+     *
+     * Copies new video frames of all players, which were updated since the last call, into the atlas
+     * and uploads them to the atlas texture. Updated tiles next to each other on the same shelf are uploaded
+     * with a single texture update, other tiles with one update each, so unchanged tiles are never uploaded.
+     *
+     * Call it once per your application frame, after updating all players with GleedUpdatePlayer.
+     *
+     * \param atlas GleedVideoAtlas instance
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedUpdateVideoAtlas(GleedVideoAtlas *atlas);
+
+    /**
+     * Get the video atlas texture
+     *
+     * Render tiles from it by passing rectangles obtained from GleedAddPlayerToAtlas as source rectangles.
+     *
+     * The texture is owned by the atlas, do not destroy it.
+     *
+     * \param atlas GleedVideoAtlas instance
+     *
+     * \returns Atlas SDL_Texture, or NULL on error.
+     */
+    extern SDL_Texture *GleedGetVideoAtlasTexture(GleedVideoAtlas *atlas);
+
+    /**
+     * Free the video atlas
+     *
+     * Destroys the atlas texture. Players added to the atlas are not affected.
+     *
+     * \param atlas GleedVideoAtlas instance
+     */
+    extern void GleedFreeVideoAtlas(GleedVideoAtlas *atlas);
+
+    /**
+        Video compositor structure
+
+        Video compositor combines current frames of two GleedMoviePlayer instances into one texture,
+        for transitions between clips. Frames are blended while still in YUV (using SSE2 or NEON when available),
+        so a transition costs a single RGB conversion and upload, instead of two frames and an alpha-blended render pass.
+
+        Video compositor can be created with GleedCreateVideoCompositor() and must be freed with GleedFreeVideoCompositor().
+
+        Opaque structure, do not modify its members directly.
+    */
+    typedef struct GleedVideoCompositor GleedVideoCompositor;
+
+    /**
+     * Video transition type
+     */
+    typedef enum
+    {
+        GLEED_VIDEO_TRANSITION_CROSSFADE = 0,       /**< New frame fades in over the old one */
+        GLEED_VIDEO_TRANSITION_WIPE_HORIZONTAL = 1, /**< New frame is uncovered from left to right */
+        GLEED_VIDEO_TRANSITION_WIPE_VERTICAL = 2,   /**< New frame is uncovered from top to bottom */
+    } GleedVideoTransition;
+
+    /**
+     * Create a video compositor
+     *
+     * Creates a SDL_PIXELFORMAT_RGB24 streaming texture of given size, owned by the compositor.
+     * Players composed with it must have videos of exactly this size.
+     *
+     * \param renderer SDL_Renderer instance to create the compositor texture for
+     * \param w Width of the videos in pixels
+     * \param h Height of the videos in pixels
+     *
+     * \returns Pointer to the compositor instance, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedVideoCompositor *GleedCreateVideoCompositor(SDL_Renderer *renderer, int w, int h);
+
+    /**
+     * Compose current frames of two players into the compositor texture
+     *
+     * Call it after updating both players with GleedUpdatePlayer. Both players must have decoded at least one frame.
+     *
+     * Players still convert their frames to RGB on their own, which is not needed while they are composed,
+     * so you may disable it with GleedSetVideoFrameConversion on their movies for the time of the transition.
+     * Their own textures then keep the last converted frame, and catch up once conversion is enabled again.
+     *
+     * \param compositor GleedVideoCompositor instance
+     * \param from Player showing the old clip
+     * \param to Player showing the new clip
+     * \param transition Transition type
+     * \param progress Transition progress from 0 (only old frame is visible) to 1 (only new frame is visible)
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedComposePlayers(
+        GleedVideoCompositor *compositor,
+        GleedMoviePlayer *from,
+        GleedMoviePlayer *to,
+        GleedVideoTransition transition,
+        float progress);
+
+    /**
+     * Get the video compositor texture
+     *
+     * The texture is owned by the compositor, do not destroy it.
+     *
+     * \param compositor GleedVideoCompositor instance
+     *
+     * \returns Compositor SDL_Texture, or NULL on error.
+     */
+    extern SDL_Texture *GleedGetVideoCompositorTexture(GleedVideoCompositor *compositor);
+
+    /**
+     * Free the video compositor
+     *
+     * Destroys the compositor texture. Composed players are not affected.
+     *
+     * \param compositor GleedVideoCompositor instance
+     */
+    extern void GleedFreeVideoCompositor(GleedVideoCompositor *compositor);
+
+    /**
+        Audio mixer structure
+
+        Audio mixer plays audio of many GleedMoviePlayer instances through a single SDL_AudioStream bound to a device.
+        Each time the device needs more samples, the mixer pulls them from all players, applies per-player gain
+        (using SSE or NEON when available) and queues one mixed buffer, so the device has only one stream to serve
+        no matter how many clips play with sound.
+
+        Audio mixer can be created with GleedCreateAudioMixer() and must be freed with GleedFreeAudioMixer().
+
+        Opaque structure, do not modify its members directly.
+    */
+    typedef struct GleedAudioMixer GleedAudioMixer;
+
+    /**
+     * Create an audio mixer
+     *
+     * Creates an audio stream and binds it to the device. Samples are mixed in float format
+     * with the channels count and frequency of the device.
+     *
+     * \param dev SDL_AudioDeviceID of the opened audio device to output mixed audio to
+     *
+     * \returns Pointer to the mixer instance, or NULL on error. Call GleedGetError to get the error message.
+     */
+    extern GleedAudioMixer *GleedCreateAudioMixer(SDL_AudioDeviceID dev);
+
+    /**
+     * Add a player to the audio mixer
+     *
+     * Replaces the player audio output set with GleedSetPlayerAudioOutput (if any). Player keeps queueing
+     * its samples on GleedUpdatePlayer as usual, and paused players are skipped by the mixer.
+     *
+     * Player is removed from the mixer automatically when it's freed, or when GleedSetPlayerAudioOutput is called for it.
+     *
+     * \param mixer GleedAudioMixer instance
+     * \param player GleedMoviePlayer instance with an audio track
+     * \param gain Multiplier for player samples, 1.0 keeps the original volume
+     *
+     * \returns True on success, false on error. Call GleedGetError to get the error message.
+     */
+    extern bool GleedAddPlayerToMixer(GleedAudioMixer *mixer, GleedMoviePlayer *player, float gain);
+
+    /**
+     * Set gain of a mixed player
+     *
+     * \param mixer GleedAudioMixer instance
+     * \param player GleedMoviePlayer instance added to the mixer
+     * \param gain Multiplier for player samples, 1.0 keeps the original volume
+     */
+    extern void GleedSetMixerPlayerGain(GleedAudioMixer *mixer, GleedMoviePlayer *player, float gain);
+
+    /**
+     * Remove a player from the audio mixer
+     *
+     * Samples queued by the player but not yet mixed are dropped. Player is left without audio output.
+     *
+     * \param mixer GleedAudioMixer instance
+     * \param player GleedMoviePlayer instance
+     */
+    extern void GleedRemovePlayerFromMixer(GleedAudioMixer *mixer, GleedMoviePlayer *player);
+
+    /**
+     * Free the audio mixer
+     *
+     * Unbinds the mixed stream from the device and leaves all mixed players without audio output.
+     *
+     * \param mixer GleedAudioMixer instance
+     */
+    extern void GleedFreeAudioMixer(GleedAudioMixer *mixer);
+
     /**
      * Free the player
      *
      * This function must be called when you no longer need the player instance.
      *
-     * It will free all resources associated with the player, but NOT the movie instance attached to it.
+     * It will free all resources associated with the player, but NOT the movie instance attached to it,
+     * unless that movie was opened from the player playlist.
      *
      * \param player GleedMoviePlayer instance
      */
@@ -1,20 +1,62 @@
 #include "gleed_movie_internal.h"
 
-static char gleed_movie_error[1024] = {0};
+#define GLEED_ERROR_BUFFER_SIZE 1024
+
+/* Errors are kept per thread, as movies may be opened and decoded on worker threads */
+static SDL_TLSID gleed_movie_error_tls;
+
+static char *GleedGetErrorBuffer(void)
+{
+    char *buffer = (char *)SDL_GetTLS(&gleed_movie_error_tls);
+
+    if (!buffer)
+    {
+        buffer = (char *)SDL_calloc(1, GLEED_ERROR_BUFFER_SIZE);
+
+        if (!buffer || !SDL_SetTLS(&gleed_movie_error_tls, buffer, SDL_free))
+        {
+            SDL_free(buffer);
+            return NULL;
+        }
+    }
+
+    return buffer;
+}
 
 static int GleedCachedFrameComparator(const void *a, const void *b)
 {
     const CachedMovieFrame *frame_a = (const CachedMovieFrame *)a;
     const CachedMovieFrame *frame_b = (const CachedMovieFrame *)b;
 
-    return frame_a->timecode - frame_b->timecode;
+    if (frame_a->timecode != frame_b->timecode)
+    {
+        return frame_a->timecode < frame_b->timecode ? -1 : 1;
+    }
+
+    /*
+        SDL_qsort is not stable, and frames sharing a timecode must stay in decode (file) order,
+        e.g. an invisible alt-ref frame has to come before the visible frame predicted from it.
+    */
+    if (frame_a->offset != frame_b->offset)
+    {
+        return frame_a->offset < frame_b->offset ? -1 : 1;
+    }
+
+    return 0;
 }
 
 bool GleedSetError(const char *fmt, ...)
 {
+    char *buffer = GleedGetErrorBuffer();
+
+    if (!buffer)
+    {
+        return false;
+    }
+
     va_list ap;
     va_start(ap, fmt);
-    SDL_vsnprintf(gleed_movie_error, sizeof(gleed_movie_error), fmt, ap);
+    SDL_vsnprintf(buffer, GLEED_ERROR_BUFFER_SIZE, fmt, ap);
     va_end(ap);
 
     return false;
@@ -22,7 +64,9 @@ bool GleedSetError(const char *fmt, ...)
 
 const char *GleedGetError()
 {
-    return gleed_movie_error;
+    const char *buffer = GleedGetErrorBuffer();
+
+    return buffer ? buffer : "";
 }
 
 GleedMovie *GleedOpen(const char *file)
@@ -35,7 +79,48 @@ GleedMovie *GleedOpen(const char *file)
         return NULL;
     }
 
-    return GleedOpenIO(stream);
+    GleedMovie *movie = GleedOpenIO(stream);
+
+    /* Only used to read preloaded video windows in background, which are read synchronously without it */
+    if (movie)
+    {
+        movie->file_path = SDL_strdup(file);
+    }
+
+    return movie;
+}
+
+static void GleedSelectDefaultTracks(GleedMovie *movie)
+{
+    /* Pre-select default tracks if possible */
+    for (int i = 0; i < movie->ntracks; i++)
+    {
+        GleedMovieTrack *tr = &movie->tracks[i];
+        if (tr->type == GLEED_TRACK_TYPE_VIDEO && movie->current_video_track == GLEED_NO_TRACK)
+        {
+            GleedSelectTrack(movie, GLEED_TRACK_TYPE_VIDEO, i);
+        }
+        else if (tr->type == GLEED_TRACK_TYPE_AUDIO && movie->current_audio_track == GLEED_NO_TRACK)
+        {
+            GleedSelectTrack(movie, GLEED_TRACK_TYPE_AUDIO, i);
+        }
+
+        /* Important step to ensure we have frames ordered chronologically, by timecode */
+        SDL_qsort(movie->cached_frames[i], movie->count_cached_frames[i], sizeof(CachedMovieFrame), GleedCachedFrameComparator);
+    }
+}
+
+static void GleedFreeTracksData(GleedMovie *movie)
+{
+    for (int i = 0; i < movie->ntracks; i++)
+    {
+        SDL_free(movie->cached_frames[i]);
+
+        if (movie->tracks[i].codec_private_data)
+        {
+            SDL_free(movie->tracks[i].codec_private_data);
+        }
+    }
 }
 
 GleedMovie *GleedOpenIO(SDL_IOStream *io)
@@ -56,50 +141,191 @@ GleedMovie *GleedOpenIO(SDL_IOStream *io)
     movie->current_audio_track = GLEED_NO_TRACK;
     movie->current_video_track = GLEED_NO_TRACK;
 
+    movie->io_lock = SDL_CreateMutex();
+
+    if (!movie->io_lock)
+    {
+        GleedSetError("Failed to create movie IO lock: %s", SDL_GetError());
+        SDL_free(movie);
+        return NULL;
+    }
+
     if (!GleedParseWebM(movie))
     {
+        /* Tracks parsed before the failure still own their data */
+        GleedFreeTracksData(movie);
+        SDL_DestroyMutex(movie->io_lock);
         SDL_free(movie);
         return NULL;
     }
 
-    /* Pre-select default tracks if possible */
-    if (movie->ntracks > 0)
+    GleedSelectDefaultTracks(movie);
+
+    return movie;
+}
+
+/* Exchanges everything that GleedParseWebM fills in */
+static void GleedSwapParsedData(GleedMovie *a, GleedMovie *b)
+{
+    GleedMovie temp;
+
+    SDL_memcpy(temp.tracks, a->tracks, sizeof(temp.tracks));
+    SDL_memcpy(temp.count_cached_frames, a->count_cached_frames, sizeof(temp.count_cached_frames));
+    SDL_memcpy(temp.capacity_cached_frames, a->capacity_cached_frames, sizeof(temp.capacity_cached_frames));
+    SDL_memcpy(temp.cached_frames, a->cached_frames, sizeof(temp.cached_frames));
+    temp.ntracks = a->ntracks;
+    temp.timecode_scale = a->timecode_scale;
+
+    SDL_memcpy(a->tracks, b->tracks, sizeof(a->tracks));
+    SDL_memcpy(a->count_cached_frames, b->count_cached_frames, sizeof(a->count_cached_frames));
+    SDL_memcpy(a->capacity_cached_frames, b->capacity_cached_frames, sizeof(a->capacity_cached_frames));
+    SDL_memcpy(a->cached_frames, b->cached_frames, sizeof(a->cached_frames));
+    a->ntracks = b->ntracks;
+    a->timecode_scale = b->timecode_scale;
+
+    SDL_memcpy(b->tracks, temp.tracks, sizeof(b->tracks));
+    SDL_memcpy(b->count_cached_frames, temp.count_cached_frames, sizeof(b->count_cached_frames));
+    SDL_memcpy(b->capacity_cached_frames, temp.capacity_cached_frames, sizeof(b->capacity_cached_frames));
+    SDL_memcpy(b->cached_frames, temp.cached_frames, sizeof(b->cached_frames));
+    b->ntracks = temp.ntracks;
+    b->timecode_scale = temp.timecode_scale;
+}
+
+static bool GleedIsSameAudioSetup(const GleedMovieTrack *a, const GleedMovieTrack *b)
+{
+    if (SDL_strncmp(a->codec_id, b->codec_id, sizeof(a->codec_id)) != 0 ||
+        a->audio_channels != b->audio_channels ||
+        a->audio_sample_frequency != b->audio_sample_frequency)
     {
-        for (int i = 0; i < movie->ntracks; i++)
-        {
-            GleedMovieTrack *tr = &movie->tracks[i];
-            if (tr->type == GLEED_TRACK_TYPE_VIDEO && movie->current_video_track == GLEED_NO_TRACK)
-            {
-                GleedSelectTrack(movie, GLEED_TRACK_TYPE_VIDEO, i);
-            }
-            else if (tr->type == GLEED_TRACK_TYPE_AUDIO && movie->current_audio_track == GLEED_NO_TRACK)
-            {
-                GleedSelectTrack(movie, GLEED_TRACK_TYPE_AUDIO, i);
-            }
+        return false;
+    }
 
-            /* Important step to ensure we have frames ordered chronologically, by timecode */
-            SDL_qsort(movie->cached_frames[i], movie->count_cached_frames[i], sizeof(CachedMovieFrame), GleedCachedFrameComparator);
-        }
+    /* Vorbis decoder is built from setup headers, so they must match exactly */
+    if (a->codec_private_size != b->codec_private_size)
+    {
+        return false;
     }
 
-    return movie;
+    return a->codec_private_size == 0 || SDL_memcmp(a->codec_private_data, b->codec_private_data, a->codec_private_size) == 0;
 }
 
-void GleedFreeMovie(GleedMovie *movie, bool closeio)
+bool GleedReopen(GleedMovie *movie, SDL_IOStream *io, bool closeio)
 {
-    if (!movie)
-        return;
+    if (!movie || !io)
+    {
+        return GleedSetError("movie and io cannot be NULL");
+    }
 
-    for (int i = 0; i < movie->ntracks; i++)
+    /* New file is parsed aside, so the movie stays intact if it's broken */
+    GleedMovie *parsed = SDL_calloc(1, sizeof(GleedMovie));
+
+    if (!parsed)
     {
-        SDL_free(movie->cached_frames[i]);
+        return GleedSetError("Failed to allocate memory for movie");
+    }
 
-        if (movie->tracks[i].codec_private_data)
-        {
-            SDL_free(movie->tracks[i].codec_private_data);
-        }
+    parsed->io = io;
+
+    if (!GleedParseWebM(parsed))
+    {
+        GleedFreeTracksData(parsed);
+        SDL_free(parsed);
+        return false;
+    }
+
+    const GleedMovieCodecType old_video_codec = movie->video_codec;
+    const Sint32 old_audio_track = movie->current_audio_track;
+
+    SDL_LockMutex(movie->io_lock);
+
+    /* From now on, parsed holds the old file tracks */
+    GleedSwapParsedData(movie, parsed);
+
+    movie->current_video_track = GLEED_NO_TRACK;
+    movie->current_audio_track = GLEED_NO_TRACK;
+    movie->video_codec = GLEED_CODEC_TYPE_UNKNOWN;
+    movie->audio_codec = GLEED_CODEC_TYPE_UNKNOWN;
+    movie->total_frames = 0;
+    movie->total_audio_frames = 0;
+
+    GleedSelectDefaultTracks(movie);
+
+    /* Video decoders restart on the first keyframe by themselves, but only handle their own codec */
+    if (movie->video_codec != old_video_codec)
+    {
+        GleedCloseVPX(movie);
+#ifdef GLEED_ENABLE_AV1
+        GleedCloseDav1d(movie);
+#endif
+    }
+#ifdef GLEED_ENABLE_AV1
+    else
+    {
+        GleedResetDav1d(movie);
+    }
+#endif
+
+    const bool same_audio = old_audio_track != GLEED_NO_TRACK &&
+                            movie->current_audio_track != GLEED_NO_TRACK &&
+                            GleedIsSameAudioSetup(&parsed->tracks[old_audio_track], GleedGetAudioTrack(movie));
+
+    if (same_audio)
+    {
+        GleedResetVorbis(movie);
+        GleedResetOpus(movie);
+    }
+    else
+    {
+        GleedCloseVorbis(movie);
+        GleedCloseOpus(movie);
+    }
+
+    /* Preloaded window describes bytes of the old file, but it's refilled from the new one on the next read */
+    GleedCloseVideoWindow(movie);
+
+    /* New stream may come from anywhere, so its window is only read synchronously */
+    SDL_free(movie->file_path);
+    movie->file_path = NULL;
+
+    /* Preloaded audio belongs to the old file */
+    SDL_free(movie->encoded_audio_buffer);
+    movie->encoded_audio_buffer = NULL;
+    movie->encoded_audio_buffer_size = 0;
+    movie->encoded_audio_frame = NULL;
+    movie->encoded_audio_frame_size = 0;
+    movie->decoded_audio_samples = 0;
+    movie->has_decoded_video_frame = false;
+    movie->has_pipelined_video_frame = false;
+    movie->has_pipeline_error = false;
+
+    if (closeio || movie->owns_io)
+    {
+        SDL_CloseIO(movie->io);
     }
 
+    movie->owns_io = false;
+
+    movie->io = io;
+    movie->current_frame = 0;
+    movie->current_audio_frame = 0;
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    GleedFlushPacketQueues(movie);
+
+    GleedFreeTracksData(parsed);
+    SDL_free(parsed);
+
+    return true;
+}
+
+void GleedFreeMovie(GleedMovie *movie, bool closeio)
+{
+    if (!movie)
+        return;
+
+    GleedFreeTracksData(movie);
+
     if (movie->conversion_video_frame_buffer)
     {
         SDL_free(movie->conversion_video_frame_buffer);
@@ -110,6 +336,13 @@ void GleedFreeMovie(GleedMovie *movie, bool closeio)
         SDL_free(movie->encoded_video_frame);
     }
 
+    if (movie->audio_frame_read_buffer)
+    {
+        SDL_free(movie->audio_frame_read_buffer);
+    }
+
+    GleedFreePacketPool(movie);
+
     if (movie->decoded_audio_frame)
     {
         SDL_free(movie->decoded_audio_frame);
@@ -120,19 +353,34 @@ void GleedFreeMovie(GleedMovie *movie, bool closeio)
         SDL_DestroySurface(movie->current_frame_surface);
     }
 
+    GleedCloseVideoWindow(movie);
+    SDL_free(movie->video_window_buffer);
+    SDL_free(movie->video_prefetch_buffer);
+    SDL_free(movie->file_path);
+    SDL_free(movie->held_video_frame_buffer);
+
     if (movie->encoded_audio_buffer)
     {
         SDL_free(movie->encoded_audio_buffer);
     }
 
+    GleedResetDirtyBlocks(movie);
+
     GleedCloseVorbis(movie);
+    GleedCloseOpus(movie);
     GleedCloseVPX(movie);
+#ifdef GLEED_ENABLE_AV1
+    GleedCloseDav1d(movie);
+#endif
 
-    if (closeio)
+    /* Movies opened asynchronously own their file stream */
+    if (closeio || movie->owns_io)
     {
         SDL_CloseIO(movie->io);
     }
 
+    SDL_DestroyMutex(movie->io_lock);
+
     SDL_free(movie);
 }
 
@@ -160,7 +408,7 @@ SDL_Texture *GleedCreatePlaybackTexture(GleedMovie *movie, SDL_Renderer *rendere
     return texture;
 }
 
-void GleedAddCachedFrame(GleedMovie *movie, Uint32 track, Uint64 timecode, Uint32 offset, Uint32 size, bool key_frame)
+void GleedAddCachedFrame(GleedMovie *movie, Uint32 track, Uint64 timecode, Uint32 offset, Uint32 size, bool key_frame, bool visible)
 {
     if (!movie)
         return;
@@ -192,6 +440,7 @@ void GleedAddCachedFrame(GleedMovie *movie, Uint32 track, Uint64 timecode, Uint3
     frame->offset = offset;
     frame->size = size;
     frame->key_frame = key_frame;
+    frame->visible = visible;
 
     /* We record the actual memory offset for each frame (accumulating the sizes of previous frames) */
     if (new_frame_index == 0)
@@ -235,7 +484,7 @@ bool GleedCanPlaybackAudio(GleedMovie *movie)
     return movie && movie->ntracks > 0 && movie->total_audio_frames > 0 && movie->current_audio_track != GLEED_NO_TRACK;
 }
 
-static GleedMovieCodecType GleedGetTrackCodec(GleedMovieTrack *track)
+GleedMovieCodecType GleedGetTrackCodec(GleedMovieTrack *track)
 {
     if (SDL_strncmp(track->codec_id, "V_VP8", 32) == 0)
     {
@@ -245,6 +494,10 @@ static GleedMovieCodecType GleedGetTrackCodec(GleedMovieTrack *track)
     {
         return GLEED_CODEC_TYPE_VP9;
     }
+    else if (SDL_strncmp(track->codec_id, "V_AV1", 32) == 0)
+    {
+        return GLEED_CODEC_TYPE_AV1;
+    }
     else if (SDL_strncmp(track->codec_id, "A_VORBIS", 32) == 0)
     {
         return GLEED_CODEC_TYPE_VORBIS;
@@ -275,25 +528,37 @@ void GleedSelectTrack(GleedMovie *movie, GleedMovieTrackType type, int track)
     if (type == GLEED_TRACK_TYPE_VIDEO)
     {
         movie->current_video_track = track;
+        movie->video_frame_primed = false;
+        movie->has_pipelined_video_frame = false;
+        movie->has_pipeline_error = false;
 
         GleedMovieTrack *new_video_track = GleedGetVideoTrack(movie);
 
         movie->video_codec = GleedGetTrackCodec(new_video_track);
         movie->total_frames = new_video_track->total_frames;
 
-        if (movie->current_frame_surface)
+        GleedResetDirtyBlocks(movie);
+
+        /* Surface of the same size is kept, e.g. when a movie is reopened with another file */
+        if (movie->current_frame_surface &&
+            (movie->current_frame_surface->w != (int)new_video_track->video_width || movie->current_frame_surface->h != (int)new_video_track->video_height))
         {
             SDL_DestroySurface(movie->current_frame_surface);
+            movie->current_frame_surface = NULL;
         }
 
-        movie->current_frame_surface = SDL_CreateSurface(
-            new_video_track->video_width,
-            new_video_track->video_height,
-            SDL_PIXELFORMAT_RGB24);
+        if (!movie->current_frame_surface)
+        {
+            movie->current_frame_surface = SDL_CreateSurface(
+                new_video_track->video_width,
+                new_video_track->video_height,
+                SDL_PIXELFORMAT_RGB24);
+        }
     }
     else if (type == GLEED_TRACK_TYPE_AUDIO)
     {
         movie->current_audio_track = track;
+        movie->audio_frame_primed = false;
 
         GleedMovieTrack *new_audio_track = GleedGetAudioTrack(movie);
         movie->audio_codec = GleedGetTrackCodec(new_audio_track);
@@ -301,6 +566,12 @@ void GleedSelectTrack(GleedMovie *movie, GleedMovieTrackType type, int track)
         movie->audio_spec.channels = new_audio_track->audio_channels;
         movie->audio_spec.freq = new_audio_track->audio_sample_frequency;
         movie->audio_spec.format = SDL_AUDIO_F32;
+
+        /* Opus decoder resamples on its own, for free */
+        if (movie->audio_codec == GLEED_CODEC_TYPE_OPUS && movie->opus_decode_frequency)
+        {
+            movie->audio_spec.freq = movie->opus_decode_frequency;
+        }
     }
 }
 
@@ -324,147 +595,1049 @@ bool GleedHasNextVideoFrame(GleedMovie *movie)
     return movie && GleedCanPlaybackVideo(movie) && movie->current_frame < movie->total_frames;
 }
 
-bool GleedDecodeVideoFrame(GleedMovie *movie)
+static bool GleedDecodeVideoPacket(GleedMovie *movie, bool convert)
 {
-    if (!movie)
-        return false;
-
-    if (!GleedCanPlaybackVideo(movie))
+    if (movie->video_codec == GLEED_CODEC_TYPE_VP8 || movie->video_codec == GLEED_CODEC_TYPE_VP9)
     {
-        GleedSetError("No tracks or playback data available");
-        return false;
+        return GleedDecodeVPX(movie, convert);
     }
-
-    GleedMovieTrack *video_track = GleedGetVideoTrack(movie);
-
-    GleedReadCurrentFrame(movie, GLEED_TRACK_TYPE_VIDEO);
-
-    if (movie->video_codec == GLEED_CODEC_TYPE_VP8 || movie->video_codec == GLEED_CODEC_TYPE_VP9)
+#ifdef GLEED_ENABLE_AV1
+    else if (movie->video_codec == GLEED_CODEC_TYPE_AV1)
     {
-        return GleedDecodeVPX(movie);
+        return GleedDecodeDav1d(movie, convert);
     }
+#endif
 
     GleedSetError("Unsupported video codec, frame not decoded");
 
     return false;
 }
 
-bool GleedUpdatePlaybackTexture(GleedMovie *movie, SDL_Texture *texture)
+/* Decodes frames from the current one up to the first visible one, and leaves current_frame at it */
+static bool GleedDecodeUpToVisibleFrame(GleedMovie *movie)
 {
-    if (!movie || !texture)
-    {
-        GleedSetError("movie and texture cannot be NULL");
-        return false;
-    }
+    GleedReadCurrentFrame(movie, GLEED_TRACK_TYPE_VIDEO);
 
-    if (!movie->current_frame_surface)
+    /*
+        Invisible frames (e.g. VP8 alt-ref) are only references for the following frames,
+        so they are fed to the decoder without conversion and never take a presentation slot.
+    */
+    while (movie->current_frame + 1 < movie->total_frames && !GleedGetCurrentCachedFrame(movie, GLEED_TRACK_TYPE_VIDEO)->visible)
     {
-        GleedSetError("No frame available, you must decode a frame first");
-        return false;
-    }
+        if (!GleedDecodeVideoPacket(movie, false))
+        {
+            return false;
+        }
 
-    if (texture->format != movie->current_frame_surface->format)
-    {
-        GleedSetError("Texture format does not match video frame format, provided = %d, required = %d",
-                      texture->format, movie->current_frame_surface->format);
-        return false;
+        movie->current_frame++;
+
+        GleedReadCurrentFrame(movie, GLEED_TRACK_TYPE_VIDEO);
     }
 
-    SDL_Surface *target;
-    SDL_LockTextureToSurface(texture, NULL, &target);
-    SDL_BlitSurface(movie->current_frame_surface, NULL, target, NULL);
-    SDL_UnlockTexture(texture);
+    const bool visible = movie->current_frame >= movie->total_frames || GleedGetCurrentCachedFrame(movie, GLEED_TRACK_TYPE_VIDEO)->visible;
 
-    return true;
+    return GleedDecodeVideoPacket(movie, visible);
 }
 
-void GleedReadCurrentFrame(GleedMovie *movie, GleedMovieTrackType type)
+/* Keeps planes of the frame decoded last valid while the following ones are decoded */
+static bool GleedHoldVideoFrame(GleedMovie *movie, DecodedVideoFrame *frame)
 {
-    if (!movie)
-        return;
+    bool held = false;
 
-    int target_track_index = type == GLEED_TRACK_TYPE_VIDEO ? movie->current_video_track : movie->current_audio_track;
-
-    if (target_track_index == GLEED_NO_TRACK)
+    if (movie->video_codec == GLEED_CODEC_TYPE_VP8 || movie->video_codec == GLEED_CODEC_TYPE_VP9)
     {
-        return;
+        held = GleedHoldVPXFrame(movie);
     }
-
-    if (type == GLEED_TRACK_TYPE_VIDEO)
+#ifdef GLEED_ENABLE_AV1
+    else if (movie->video_codec == GLEED_CODEC_TYPE_AV1)
     {
-        CachedMovieFrame *frame = &movie->cached_frames[target_track_index][movie->current_frame];
-
-        if (!movie->encoded_video_frame || movie->encoded_video_frame_size < frame->size)
-        {
-            movie->encoded_video_frame = SDL_realloc(movie->encoded_video_frame, frame->size);
-        }
+        held = GleedHoldDav1dPicture(movie);
+    }
+#endif
 
-        SDL_SeekIO(movie->io, frame->offset, SDL_IO_SEEK_SET);
+    if (held)
+    {
+        return true;
+    }
 
-        SDL_ReadIO(movie->io, movie->encoded_video_frame, frame->size);
+    /* Decoder reuses its buffers, so the planes are copied (tightly packed) instead */
+    size_t planes_size = 0;
 
-        movie->encoded_video_frame_size = frame->size;
+    for (int plane = 0; plane < 3; plane++)
+    {
+        const int plane_height = plane == 0 ? frame->height : (frame->height + 1) / 2;
+        planes_size += (size_t)frame->strides[plane] * plane_height;
     }
-    else
+
+    if (movie->held_video_frame_buffer_size < planes_size)
     {
-        CachedMovieFrame *frame = &movie->cached_frames[target_track_index][movie->current_audio_frame];
+        Uint8 *buffer = (Uint8 *)SDL_realloc(movie->held_video_frame_buffer, planes_size);
 
-        /* If we have preloaded all our encoded audio data into one big buffer, just point inside it*/
-        if (movie->encoded_audio_buffer && movie->encoded_audio_buffer_size > 0)
+        if (!buffer)
         {
-            movie->encoded_audio_frame = movie->encoded_audio_buffer + frame->mem_offset;
+            return GleedSetError("Failed to allocate memory for held video frame");
         }
-        else
-        {
-            /* Otherwise, perform an IO read */
-            if (!movie->encoded_audio_frame || movie->encoded_audio_frame_size < frame->size)
-            {
-                movie->encoded_audio_frame = SDL_realloc(movie->encoded_audio_frame, frame->size);
-            }
 
-            SDL_SeekIO(movie->io, frame->offset, SDL_IO_SEEK_SET);
+        movie->held_video_frame_buffer = buffer;
+        movie->held_video_frame_buffer_size = planes_size;
+    }
 
-            SDL_ReadIO(movie->io, movie->encoded_audio_frame, frame->size);
-        }
+    Uint8 *write_ptr = movie->held_video_frame_buffer;
 
-        movie->encoded_audio_frame_size = frame->size;
+    for (int plane = 0; plane < 3; plane++)
+    {
+        const int plane_height = plane == 0 ? frame->height : (frame->height + 1) / 2;
+        const size_t plane_size = (size_t)frame->strides[plane] * plane_height;
+
+        SDL_memcpy(write_ptr, frame->planes[plane], plane_size);
+        frame->planes[plane] = write_ptr;
+        write_ptr += plane_size;
     }
-}
 
-Uint32 GleedGetLastFrameDecodeTime(GleedMovie *movie)
-{
-    if (!movie)
-        return 0;
-    return movie->last_frame_decode_ms;
+    return true;
 }
 
-Uint32 GleedGetTotalVideoFrames(GleedMovie *movie)
+static void GleedReleaseHeldVideoFrame(GleedMovie *movie)
 {
-    if (!movie)
-        return 0;
-    return movie->total_frames;
+    if (movie->video_codec == GLEED_CODEC_TYPE_VP8 || movie->video_codec == GLEED_CODEC_TYPE_VP9)
+    {
+        GleedReleaseVPXFrame(movie);
+    }
+#ifdef GLEED_ENABLE_AV1
+    else if (movie->video_codec == GLEED_CODEC_TYPE_AV1)
+    {
+        GleedReleaseDav1dPicture(movie);
+    }
+#endif
 }
 
-Uint32 GleedGetCurrentFrame(GleedMovie *movie)
+/* Two stages of pipelined video decode, run in parallel */
+typedef struct
 {
-    if (!movie)
-        return 0;
-    return movie->current_frame;
-}
-
-void GleedNextVideoFrame(GleedMovie *movie)
+    GleedMovie *movie;
+    DecodedVideoFrame frame; /**< Current frame, which is converted */
+    bool converted;
+    bool decoded;
+    char convert_error[1024]; /**< Errors are per thread, and stages may run on worker threads */
+    char decode_error[1024];  /**< Error of decoding ahead */
+} GleedVideoPipelineStages;
+
+static void GleedRunVideoPipelineStage(void *userdata, int index)
 {
-    if (!movie)
-        return;
+    GleedVideoPipelineStages *stages = (GleedVideoPipelineStages *)userdata;
+    GleedMovie *movie = stages->movie;
 
-    if (!GleedCanPlaybackVideo(movie))
+    if (index == 0)
     {
-        GleedSetError("No tracks or playback data available");
+        stages->converted = GleedConvertVideoFrame(movie, &stages->frame);
+
+        if (!stages->converted)
+        {
+            SDL_strlcpy(stages->convert_error, GleedGetError(), sizeof(stages->convert_error));
+        }
+
         return;
     }
 
-    if (movie->current_frame < movie->total_frames)
-    {
+    /* Decoding ahead goes through the same frames as the next call would, and then returns to the current one */
+    const Uint32 current_frame = movie->current_frame;
+
+    movie->current_frame++;
+    movie->pipeline_start_frame = movie->current_frame;
+
+    /* Failure is reported by the next call, as the current frame is fine */
+    stages->decoded = GleedDecodeUpToVisibleFrame(movie);
+
+    if (!stages->decoded)
+    {
+        SDL_strlcpy(stages->decode_error, GleedGetError(), sizeof(stages->decode_error));
+    }
+
+    movie->pipeline_frame = movie->current_frame;
+    movie->current_frame = current_frame;
+}
+
+/*
+    Decoding the next frame and converting the current one are the two most expensive parts of each frame,
+    and they only share planes of the current frame, which the decoder is told to hold on to.
+*/
+static bool GleedDecodeVideoFramePipelined(GleedMovie *movie)
+{
+    /* Unless it was decoded ahead by the previous call, current frame is decoded right away */
+    if (!movie->has_pipelined_video_frame)
+    {
+        movie->defer_video_conversion = true;
+
+        const bool decoded = GleedDecodeUpToVisibleFrame(movie);
+
+        movie->defer_video_conversion = false;
+
+        if (!decoded)
+        {
+            return false;
+        }
+
+        /* Invisible last frame gives no picture */
+        if (!movie->has_pipelined_video_frame)
+        {
+            return true;
+        }
+    }
+
+    GleedVideoPipelineStages stages;
+    SDL_zero(stages);
+    stages.movie = movie;
+    stages.frame = movie->pipelined_video_frame;
+
+    movie->has_pipelined_video_frame = false;
+
+    /* Planes of the previous frame are released, and the ones of the current frame must outlive decoding ahead */
+    GleedReleaseHeldVideoFrame(movie);
+
+    if (!GleedHoldVideoFrame(movie, &stages.frame))
+    {
+        return false;
+    }
+
+    movie->decoded_video_frame = stages.frame;
+    movie->has_decoded_video_frame = true;
+
+    const bool decode_ahead = movie->current_frame + 1 < movie->total_frames;
+
+    movie->defer_video_conversion = true;
+
+    GleedRunParallel(GleedRunVideoPipelineStage, &stages, decode_ahead ? 2 : 1);
+
+    movie->defer_video_conversion = false;
+
+    /*
+        Current frame is fine, so the error is kept for the next call. Packets up to the failed one were already sent
+        to the decoder, and sending them again would corrupt its references, so that call doesn't decode them again.
+    */
+    if (decode_ahead && !stages.decoded)
+    {
+        movie->has_pipelined_video_frame = false;
+        movie->has_pipeline_error = true;
+        SDL_strlcpy(movie->pipeline_error, stages.decode_error, sizeof(movie->pipeline_error));
+    }
+
+    if (!stages.converted)
+    {
+        return GleedSetError("%s", stages.convert_error);
+    }
+
+    return true;
+}
+
+bool GleedDecodeVideoFrame(GleedMovie *movie)
+{
+    if (!movie)
+        return false;
+
+    if (!GleedCanPlaybackVideo(movie))
+    {
+        GleedSetError("No tracks or playback data available");
+        return false;
+    }
+
+    if (movie->video_frame_primed)
+    {
+        movie->video_frame_primed = false;
+
+        /* Frame is already decoded, but a caller-owned target still needs its own conversion */
+        return !movie->target_pixels || GleedConvertVideoFrame(movie, &movie->decoded_video_frame);
+    }
+
+    /* Like a frame failing to decode right away, the current frame is left at the failed one */
+    if (movie->has_pipeline_error)
+    {
+        movie->has_pipeline_error = false;
+
+        if (movie->current_frame == movie->pipeline_start_frame)
+        {
+            movie->current_frame = movie->pipeline_frame;
+
+            return GleedSetError("%s", movie->pipeline_error);
+        }
+    }
+
+    /*
+        Frame decoded ahead is only usable if playback went on right after the previous frame,
+        otherwise the current frame is decoded from scratch (e.g. after a seek to a keyframe).
+    */
+    if (movie->has_pipelined_video_frame)
+    {
+        if (movie->current_frame == movie->pipeline_start_frame)
+        {
+            movie->current_frame = movie->pipeline_frame;
+        }
+        else
+        {
+            movie->has_pipelined_video_frame = false;
+        }
+    }
+
+    if (movie->pipelined_decoding || movie->has_pipelined_video_frame)
+    {
+        return GleedDecodeVideoFramePipelined(movie);
+    }
+
+    /* Planes of the previous frame are released by the decoder from now on */
+    movie->has_decoded_video_frame = false;
+
+    GleedReleaseHeldVideoFrame(movie);
+
+    return GleedDecodeUpToVisibleFrame(movie);
+}
+
+void GleedSetPipelinedDecoding(GleedMovie *movie, bool enabled)
+{
+    if (!movie)
+        return;
+
+    /* Frame already decoded ahead is still used by the next decode call, to keep the decoder in sync */
+    movie->pipelined_decoding = enabled;
+}
+
+bool GleedSetVideoDecoderOptions(GleedMovie *movie, const GleedVideoDecoderOptions *options)
+{
+    if (!movie || !options)
+    {
+        return GleedSetError("movie and options cannot be NULL");
+    }
+
+    if (options->vp8_deblocking_level < 0 || options->vp8_deblocking_level > 16)
+    {
+        return GleedSetError("VP8 deblocking level must be in 0-16 range, got %d", options->vp8_deblocking_level);
+    }
+
+    if (options->vp9_threads < 0)
+    {
+        return GleedSetError("VP9 decoder thread count cannot be negative");
+    }
+
+    /* Decoders pick changes up on their own, recreating themselves at the next keyframe if needed */
+    movie->video_decoder_options = *options;
+
+    return true;
+}
+
+void GleedGetVideoDecoderOptions(GleedMovie *movie, GleedVideoDecoderOptions *options)
+{
+    if (!movie || !options)
+        return;
+
+    *options = movie->video_decoder_options;
+}
+
+bool GleedUpdatePlaybackTexture(GleedMovie *movie, SDL_Texture *texture)
+{
+    return GleedUploadPlaybackTexture(movie, texture, false);
+}
+
+bool GleedUploadPlaybackTexture(GleedMovie *movie, SDL_Texture *texture, bool full_upload)
+{
+    if (!movie || !texture)
+    {
+        GleedSetError("movie and texture cannot be NULL");
+        return false;
+    }
+
+    if (!movie->current_frame_surface)
+    {
+        GleedSetError("No frame available, you must decode a frame first");
+        return false;
+    }
+
+    if (texture->format != movie->current_frame_surface->format)
+    {
+        GleedSetError("Texture format does not match video frame format, provided = %d, required = %d",
+                      texture->format, movie->current_frame_surface->format);
+        return false;
+    }
+
+    SDL_Surface *frame_surface = movie->current_frame_surface;
+
+    /*
+        Frame surface already has texture's pixel format and acts as a persistent staging buffer,
+        so for same-sized textures we upload it directly and skip SDL's generic blitter altogether.
+    */
+    if (texture->w == frame_surface->w && texture->h == frame_surface->h)
+    {
+        /* With dirty rectangles, only regions changed since the last upload are sent */
+        if (movie->dirty_rects_enabled && movie->pending_upload_blocks && !full_upload)
+        {
+            const int rects_count = GleedCollectDirtyRects(movie, movie->pending_upload_blocks, movie->upload_rects);
+
+            for (int i = 0; i < rects_count; i++)
+            {
+                const SDL_Rect *rect = &movie->upload_rects[i];
+                const Uint8 *rect_pixels = (const Uint8 *)frame_surface->pixels + rect->y * frame_surface->pitch + rect->x * SDL_BYTESPERPIXEL(frame_surface->format);
+
+                if (!SDL_UpdateTexture(texture, rect, rect_pixels, frame_surface->pitch))
+                {
+                    return GleedSetError("Failed to update playback texture: %s", SDL_GetError());
+                }
+            }
+        }
+        else if (!SDL_UpdateTexture(texture, NULL, frame_surface->pixels, frame_surface->pitch))
+        {
+            return GleedSetError("Failed to update playback texture: %s", SDL_GetError());
+        }
+
+        if (movie->pending_upload_blocks)
+        {
+            SDL_memset(movie->pending_upload_blocks, 0, movie->dirty_blocks_w * movie->dirty_blocks_h);
+        }
+
+        return true;
+    }
+
+    SDL_Surface *target;
+    if (!SDL_LockTextureToSurface(texture, NULL, &target))
+    {
+        return GleedSetError("Failed to lock playback texture: %s", SDL_GetError());
+    }
+
+    SDL_BlitSurface(frame_surface, NULL, target, NULL);
+    SDL_UnlockTexture(texture);
+
+    return true;
+}
+
+bool GleedPrimeMovie(GleedMovie *movie)
+{
+    if (GleedHasNextVideoFrame(movie) && !movie->video_frame_primed)
+    {
+        if (!GleedDecodeVideoFrame(movie))
+        {
+            return false;
+        }
+
+        movie->video_frame_primed = true;
+    }
+
+    if (GleedHasNextAudioFrame(movie) && !movie->audio_frame_primed)
+    {
+        if (!GleedDecodeAudioFrame(movie))
+        {
+            return false;
+        }
+
+        movie->audio_frame_primed = true;
+    }
+
+    return true;
+}
+
+/* Largest frame of the track, so a read buffer of this size never has to grow */
+static Uint32 GleedGetMaxFrameSize(GleedMovie *movie, int track)
+{
+    Uint32 max_size = 0;
+
+    if (track == GLEED_NO_TRACK)
+    {
+        return 0;
+    }
+
+    for (Uint32 i = 0; i < movie->count_cached_frames[track]; i++)
+    {
+        max_size = SDL_max(max_size, movie->cached_frames[track][i].size);
+    }
+
+    return max_size;
+}
+
+bool GleedPrepareMovie(GleedMovie *movie)
+{
+    if (!movie)
+    {
+        return GleedSetError("movie cannot be NULL");
+    }
+
+    const Uint32 max_video_frame_size = GleedGetMaxFrameSize(movie, movie->current_video_track);
+
+    if (movie->encoded_video_frame_capacity < max_video_frame_size)
+    {
+        Uint8 *buffer = (Uint8 *)SDL_realloc(movie->encoded_video_frame, max_video_frame_size);
+
+        if (!buffer)
+        {
+            return GleedSetError("Failed to allocate encoded video frame buffer");
+        }
+
+        movie->encoded_video_frame = buffer;
+        movie->encoded_video_frame_capacity = max_video_frame_size;
+    }
+
+    const Uint32 max_audio_frame_size = GleedGetMaxFrameSize(movie, movie->current_audio_track);
+
+    if (movie->audio_frame_read_buffer_capacity < max_audio_frame_size)
+    {
+        Uint8 *buffer = (Uint8 *)SDL_realloc(movie->audio_frame_read_buffer, max_audio_frame_size);
+
+        if (!buffer)
+        {
+            return GleedSetError("Failed to allocate encoded audio frame buffer");
+        }
+
+        movie->audio_frame_read_buffer = buffer;
+        movie->audio_frame_read_buffer_capacity = max_audio_frame_size;
+    }
+
+    /* Decoders are created lazily, so decoding the first frames also initializes them and their output buffers */
+    return GleedPrimeMovie(movie);
+}
+
+bool GleedDecodeVideoFrameInto(GleedMovie *movie, void *pixels, int pitch, SDL_PixelFormat format)
+{
+    if (!movie || !pixels)
+    {
+        return GleedSetError("movie and pixels cannot be NULL");
+    }
+
+    if (format == SDL_PIXELFORMAT_UNKNOWN || pitch <= 0)
+    {
+        return GleedSetError("Invalid target pixel format or pitch");
+    }
+
+    movie->target_pixels = pixels;
+    movie->target_pitch = pitch;
+    movie->target_format = format;
+
+    const bool decoded = GleedDecodeVideoFrame(movie);
+
+    movie->target_pixels = NULL;
+
+    return decoded;
+}
+
+void GleedSetVideoFrameConversion(GleedMovie *movie, bool enabled)
+{
+    if (!movie)
+        return;
+
+    movie->skip_video_conversion = !enabled;
+
+    /* Surface is not updated while conversion is disabled, so hashes would describe stale contents */
+    GleedResetDirtyBlocks(movie);
+}
+
+bool GleedIsOpusDecodeFrequency(int frequency)
+{
+    return frequency == 8000 || frequency == 12000 || frequency == 16000 || frequency == 24000 || frequency == 48000;
+}
+
+bool GleedSetOpusDecodeFrequency(GleedMovie *movie, int frequency)
+{
+    if (!movie)
+    {
+        return GleedSetError("movie cannot be NULL");
+    }
+
+    if (frequency != 0 && !GleedIsOpusDecodeFrequency(frequency))
+    {
+        return GleedSetError("Opus cannot be decoded at %d Hz", frequency);
+    }
+
+    if (movie->opus_decode_frequency == frequency)
+    {
+        return true;
+    }
+
+    movie->opus_decode_frequency = frequency;
+
+    if (movie->audio_codec != GLEED_CODEC_TYPE_OPUS)
+    {
+        return true;
+    }
+
+    const GleedMovieTrack *audio_track = GleedGetAudioTrack(movie);
+
+    movie->audio_spec.freq = frequency ? frequency : (int)audio_track->audio_sample_frequency;
+
+    /* Decoder is bound to its output frequency, so the next decode creates a new one */
+    GleedCloseOpus(movie);
+
+    movie->audio_frame_primed = false;
+
+    return true;
+}
+
+bool GleedGetVideoFramePlanes(GleedMovie *movie, const Uint8 *planes[3], int strides[3], SDL_PixelFormat *format, SDL_Colorspace *colorspace, int *width, int *height)
+{
+    if (!movie || !planes || !strides)
+    {
+        return GleedSetError("movie, planes and strides cannot be NULL");
+    }
+
+    if (!movie->has_decoded_video_frame)
+    {
+        return GleedSetError("No decoded video frame available");
+    }
+
+    for (int plane = 0; plane < 3; plane++)
+    {
+        planes[plane] = movie->decoded_video_frame.planes[plane];
+        strides[plane] = movie->decoded_video_frame.strides[plane];
+    }
+
+    if (format)
+    {
+        *format = movie->decoded_video_frame.format;
+    }
+
+    if (colorspace)
+    {
+        *colorspace = movie->decoded_video_frame.colorspace;
+    }
+
+    if (width)
+    {
+        *width = movie->decoded_video_frame.width;
+    }
+
+    if (height)
+    {
+        *height = movie->decoded_video_frame.height;
+    }
+
+    return true;
+}
+
+void GleedSetDirtyRectUpdates(GleedMovie *movie, bool enabled)
+{
+    if (!movie)
+        return;
+
+    movie->dirty_rects_enabled = enabled;
+
+    /* Hashes get stale while disabled, start from a full frame when enabled again */
+    GleedResetDirtyBlocks(movie);
+}
+
+const SDL_Rect *GleedGetVideoFrameDirtyRects(GleedMovie *movie, int *count)
+{
+    if (!movie || !movie->dirty_rects_enabled || !movie->dirty_rects)
+    {
+        if (count)
+            *count = 0;
+        return NULL;
+    }
+
+    if (count)
+        *count = movie->dirty_rects_count;
+
+    return movie->dirty_rects;
+}
+
+/* Copies frame data from the preloaded video window, if it's there. io_lock must be held */
+static bool GleedCopyFromVideoWindow(GleedMovie *movie, const CachedMovieFrame *frame, Uint8 *dest)
+{
+    /* Ranges are compared by subtraction, so offsets close to the type limits don't wrap around */
+    const bool in_window = movie->video_window_size > 0 &&
+                           frame->offset >= movie->video_window_offset &&
+                           frame->offset - movie->video_window_offset <= movie->video_window_size &&
+                           frame->size <= movie->video_window_size - (frame->offset - movie->video_window_offset);
+
+    if (in_window)
+    {
+        SDL_memcpy(dest, movie->video_window_buffer + (frame->offset - movie->video_window_offset), frame->size);
+    }
+
+    return in_window;
+}
+
+static bool GleedReadFromVideoWindow(GleedMovie *movie, const CachedMovieFrame *frame, Uint8 *dest)
+{
+    /* Window is refilled under the same lock by whichever thread reads video */
+    SDL_LockMutex(movie->io_lock);
+
+    const bool in_window = GleedCopyFromVideoWindow(movie, frame, dest);
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    return in_window;
+}
+
+/*
+    Finds file bytes of all video frames from the first one up to video_window_ms ahead, so they are read with a single read.
+    Audio frames interleaved between them come along for free. False if the range is too big for one read.
+*/
+static bool GleedGetVideoWindowRange(GleedMovie *movie, Uint32 first_frame, Uint32 *end_frame, Uint64 *start, Uint32 *size)
+{
+    const CachedMovieFrame *frames = movie->cached_frames[movie->current_video_track];
+    const Uint32 count = movie->count_cached_frames[movie->current_video_track];
+
+    const Uint64 window_end_timecode = frames[first_frame].timecode + GleedMillisecondsToTimecode(movie, movie->video_window_ms);
+
+    Uint64 window_start = frames[first_frame].offset;
+    Uint64 window_end = window_start + frames[first_frame].size;
+
+    Uint32 i = first_frame + 1;
+
+    /* Frames are sorted by timecode, which is not necessarily the file order (e.g. alt-ref frames) */
+    for (; i < count && frames[i].timecode <= window_end_timecode; i++)
+    {
+        window_start = SDL_min(window_start, frames[i].offset);
+        window_end = SDL_max(window_end, (Uint64)frames[i].offset + frames[i].size);
+    }
+
+    if (window_end - window_start > SDL_MAX_UINT32)
+    {
+        return false;
+    }
+
+    *end_frame = i;
+    *start = window_start;
+    *size = (Uint32)(window_end - window_start);
+
+    return true;
+}
+
+static bool GleedEnsureVideoWindowBuffer(Uint8 **buffer, Uint32 *capacity, Uint32 size)
+{
+    if (*capacity < size)
+    {
+        Uint8 *new_buffer = (Uint8 *)SDL_realloc(*buffer, size);
+
+        if (!new_buffer)
+        {
+            return false;
+        }
+
+        *buffer = new_buffer;
+        *capacity = size;
+    }
+
+    return true;
+}
+
+/* Reads the window starting at the current frame right away. io_lock must be held, as the buffer is shared with demuxing (GleedReadPacket) */
+static void GleedFillVideoWindow(GleedMovie *movie)
+{
+    Uint32 end_frame;
+    Uint64 start;
+    Uint32 size;
+
+    movie->video_window_size = 0;
+
+    /* Frames are just read one by one then */
+    if (!GleedGetVideoWindowRange(movie, movie->current_frame, &end_frame, &start, &size) ||
+        !GleedEnsureVideoWindowBuffer(&movie->video_window_buffer, &movie->video_window_capacity, size))
+    {
+        return;
+    }
+
+    SDL_SeekIO(movie->io, start, SDL_IO_SEEK_SET);
+
+    movie->video_window_offset = start;
+    movie->video_window_size = (Uint32)SDL_ReadIO(movie->io, movie->video_window_buffer, size);
+    movie->video_window_first_frame = movie->current_frame;
+    movie->video_window_end_frame = end_frame;
+}
+
+/* Waits for the background read of the next window, and makes it the current window if requested. io_lock must be held */
+static void GleedFinishVideoPrefetch(GleedMovie *movie, bool use)
+{
+    if (!movie->video_prefetch_pending)
+    {
+        return;
+    }
+
+    SDL_AsyncIOOutcome outcome;
+    SDL_zero(outcome);
+
+    /* Prefetch buffer is written by SDL's I/O thread until the result is collected, so there's no giving up on it */
+    while (!SDL_WaitAsyncIOResult(movie->window_async_queue, &outcome, -1))
+    {
+    }
+
+    movie->video_prefetch_pending = false;
+
+    if (!use || outcome.result != SDL_ASYNCIO_COMPLETE || outcome.bytes_transferred == 0)
+    {
+        return;
+    }
+
+    Uint8 *buffer = movie->video_window_buffer;
+    const Uint32 capacity = movie->video_window_capacity;
+
+    movie->video_window_buffer = movie->video_prefetch_buffer;
+    movie->video_window_capacity = movie->video_prefetch_capacity;
+    movie->video_window_offset = movie->video_prefetch_offset;
+    movie->video_window_size = (Uint32)outcome.bytes_transferred;
+    movie->video_window_first_frame = movie->video_prefetch_first_frame;
+    movie->video_window_end_frame = movie->video_prefetch_end_frame;
+
+    movie->video_prefetch_buffer = buffer;
+    movie->video_prefetch_capacity = capacity;
+}
+
+/* Second file handle is opened on first use, and only once, so movies opened from streams don't retry on every frame */
+static bool GleedOpenVideoWindowAsyncFile(GleedMovie *movie)
+{
+    if (movie->window_async_file)
+    {
+        return true;
+    }
+
+    if (movie->window_async_unavailable || !movie->file_path)
+    {
+        return false;
+    }
+
+    movie->window_async_unavailable = true;
+
+    movie->window_async_queue = SDL_CreateAsyncIOQueue();
+
+    if (!movie->window_async_queue)
+    {
+        return false;
+    }
+
+    movie->window_async_file = SDL_AsyncIOFromFile(movie->file_path, "r");
+
+    if (!movie->window_async_file)
+    {
+        SDL_DestroyAsyncIOQueue(movie->window_async_queue);
+        movie->window_async_queue = NULL;
+        return false;
+    }
+
+    movie->window_async_unavailable = false;
+
+    return true;
+}
+
+/*
+    Starts reading the window following the current one in background, once about half of the current one is consumed,
+    so the read has the other half to complete before the decoder needs it. io_lock must be held.
+*/
+static void GleedStartVideoPrefetch(GleedMovie *movie)
+{
+    const Uint32 first_frame = movie->video_window_first_frame;
+    const Uint32 end_frame = movie->video_window_end_frame;
+
+    if (movie->video_prefetch_pending ||
+        movie->video_window_size == 0 ||
+        end_frame >= movie->count_cached_frames[movie->current_video_track] ||
+        movie->current_frame < first_frame ||
+        movie->current_frame - first_frame < (end_frame - first_frame) / 2)
+    {
+        return;
+    }
+
+    Uint32 next_end_frame;
+    Uint64 start;
+    Uint32 size;
+
+    if (!GleedGetVideoWindowRange(movie, end_frame, &next_end_frame, &start, &size) ||
+        !GleedOpenVideoWindowAsyncFile(movie) ||
+        !GleedEnsureVideoWindowBuffer(&movie->video_prefetch_buffer, &movie->video_prefetch_capacity, size))
+    {
+        return;
+    }
+
+    /* Window is refilled synchronously when it runs out, as if there was no prefetch */
+    if (!SDL_ReadAsyncIO(movie->window_async_file, movie->video_prefetch_buffer, start, size, movie->window_async_queue, NULL))
+    {
+        return;
+    }
+
+    movie->video_prefetch_pending = true;
+    movie->video_prefetch_offset = start;
+    movie->video_prefetch_first_frame = end_frame;
+    movie->video_prefetch_end_frame = next_end_frame;
+}
+
+/* Reads the frame from the window, taking the prefetched one or refilling it when the frame is past the current one */
+static bool GleedReadVideoFrameFromWindow(GleedMovie *movie, const CachedMovieFrame *frame, Uint8 *dest)
+{
+    SDL_LockMutex(movie->io_lock);
+
+    bool in_window = GleedCopyFromVideoWindow(movie, frame, dest);
+
+    if (!in_window && movie->video_prefetch_pending)
+    {
+        GleedFinishVideoPrefetch(movie, true);
+
+        in_window = GleedCopyFromVideoWindow(movie, frame, dest);
+    }
+
+    /* Prefetched window doesn't have it either after a seek */
+    if (!in_window)
+    {
+        GleedFillVideoWindow(movie);
+
+        in_window = GleedCopyFromVideoWindow(movie, frame, dest);
+    }
+
+    if (in_window)
+    {
+        GleedStartVideoPrefetch(movie);
+    }
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    return in_window;
+}
+
+void GleedDiscardVideoWindow(GleedMovie *movie)
+{
+    GleedFinishVideoPrefetch(movie, false);
+
+    movie->video_window_size = 0;
+}
+
+void GleedCloseVideoWindow(GleedMovie *movie)
+{
+    GleedDiscardVideoWindow(movie);
+
+    if (movie->window_async_file)
+    {
+        /* Closing is queued like a read, and the queue must not be destroyed with tasks left on it */
+        if (SDL_CloseAsyncIO(movie->window_async_file, false, movie->window_async_queue, NULL))
+        {
+            SDL_AsyncIOOutcome outcome;
+            SDL_WaitAsyncIOResult(movie->window_async_queue, &outcome, -1);
+        }
+
+        movie->window_async_file = NULL;
+    }
+
+    if (movie->window_async_queue)
+    {
+        SDL_DestroyAsyncIOQueue(movie->window_async_queue);
+        movie->window_async_queue = NULL;
+    }
+
+    movie->window_async_unavailable = false;
+}
+
+void GleedReadCurrentFrame(GleedMovie *movie, GleedMovieTrackType type)
+{
+    if (!movie)
+        return;
+
+    int target_track_index = type == GLEED_TRACK_TYPE_VIDEO ? movie->current_video_track : movie->current_audio_track;
+
+    if (target_track_index == GLEED_NO_TRACK)
+    {
+        return;
+    }
+
+    if (type == GLEED_TRACK_TYPE_VIDEO)
+    {
+        /* Packet may be already read ahead by demuxing side, then no IO is needed */
+        if (GleedTakeQueuedPacket(movie, GLEED_TRACK_TYPE_VIDEO, movie->current_frame,
+                                  &movie->encoded_video_frame, &movie->encoded_video_frame_capacity, &movie->encoded_video_frame_size))
+        {
+            return;
+        }
+
+        CachedMovieFrame *frame = &movie->cached_frames[target_track_index][movie->current_frame];
+
+        if (!movie->encoded_video_frame || movie->encoded_video_frame_capacity < frame->size)
+        {
+            movie->encoded_video_frame = SDL_realloc(movie->encoded_video_frame, frame->size);
+            movie->encoded_video_frame_capacity = frame->size;
+        }
+
+        movie->encoded_video_frame_size = frame->size;
+
+        if (movie->video_window_ms > 0 && GleedReadVideoFrameFromWindow(movie, frame, movie->encoded_video_frame))
+        {
+            return;
+        }
+
+        SDL_LockMutex(movie->io_lock);
+
+        SDL_SeekIO(movie->io, frame->offset, SDL_IO_SEEK_SET);
+
+        SDL_ReadIO(movie->io, movie->encoded_video_frame, frame->size);
+
+        SDL_UnlockMutex(movie->io_lock);
+
+        movie->encoded_video_frame_size = frame->size;
+    }
+    else
+    {
+        CachedMovieFrame *frame = &movie->cached_frames[target_track_index][movie->current_audio_frame];
+
+        /* If we have preloaded all our encoded audio data into one big buffer, just point inside it*/
+        if (movie->encoded_audio_buffer && movie->encoded_audio_buffer_size > 0)
+        {
+            movie->encoded_audio_frame = movie->encoded_audio_buffer + frame->mem_offset;
+        }
+        else if (GleedTakeQueuedPacket(movie, GLEED_TRACK_TYPE_AUDIO, movie->current_audio_frame,
+                                       &movie->audio_frame_read_buffer, &movie->audio_frame_read_buffer_capacity, &movie->encoded_audio_frame_size))
+        {
+            movie->encoded_audio_frame = movie->audio_frame_read_buffer;
+            return;
+        }
+        else
+        {
+            /* Otherwise, perform an IO read */
+            if (!movie->audio_frame_read_buffer || movie->audio_frame_read_buffer_capacity < frame->size)
+            {
+                movie->audio_frame_read_buffer = SDL_realloc(movie->audio_frame_read_buffer, frame->size);
+                movie->audio_frame_read_buffer_capacity = frame->size;
+            }
+
+            /* Audio interleaved with preloaded video frames may be in memory already */
+            if (!GleedReadFromVideoWindow(movie, frame, movie->audio_frame_read_buffer))
+            {
+                SDL_LockMutex(movie->io_lock);
+
+                SDL_SeekIO(movie->io, frame->offset, SDL_IO_SEEK_SET);
+
+                SDL_ReadIO(movie->io, movie->audio_frame_read_buffer, frame->size);
+
+                SDL_UnlockMutex(movie->io_lock);
+            }
+
+            movie->encoded_audio_frame = movie->audio_frame_read_buffer;
+        }
+
+        movie->encoded_audio_frame_size = frame->size;
+    }
+}
+
+Uint32 GleedGetLastFrameDecodeTime(GleedMovie *movie)
+{
+    if (!movie)
+        return 0;
+    return movie->last_frame_decode_ms;
+}
+
+Uint32 GleedGetTotalVideoFrames(GleedMovie *movie)
+{
+    if (!movie)
+        return 0;
+    return movie->total_frames;
+}
+
+Uint32 GleedGetCurrentFrame(GleedMovie *movie)
+{
+    if (!movie)
+        return 0;
+    return movie->current_frame;
+}
+
+void GleedNextVideoFrame(GleedMovie *movie)
+{
+    if (!movie)
+        return;
+
+    if (!GleedCanPlaybackVideo(movie))
+    {
+        GleedSetError("No tracks or playback data available");
+        return;
+    }
+
+    if (movie->current_frame < movie->total_frames)
+    {
         movie->current_frame++;
     }
 }
@@ -503,7 +1676,46 @@ void GleedSeekFrame(GleedMovie *movie, Uint32 frame)
     if (frame >= movie->total_frames)
         return;
 
+    const CachedMovieFrame *video_frames = movie->cached_frames[movie->current_video_track];
+
+    /* Decoding can only start from a keyframe, so we go back to the preceding one (first frame is always a keyframe) */
+    while (frame > 0 && !video_frames[frame].key_frame)
+    {
+        frame--;
+    }
+
+    /* Primed frames stay valid only if we stay where they were decoded */
+    if (frame != movie->current_frame)
+    {
+        movie->video_frame_primed = false;
+    }
+
+    /* Decoding restarts from a keyframe, which doesn't depend on frames decoded ahead */
+    movie->has_pipelined_video_frame = false;
+    movie->has_pipeline_error = false;
+
     movie->current_frame = frame;
+
+    if (movie->current_audio_track != GLEED_NO_TRACK)
+    {
+        const CachedMovieFrame *audio_frames = movie->cached_frames[movie->current_audio_track];
+        Uint32 audio_frame = 0;
+
+        while (audio_frame < movie->total_audio_frames && audio_frames[audio_frame].timecode < video_frames[frame].timecode)
+        {
+            audio_frame++;
+        }
+
+        if (audio_frame != movie->current_audio_frame)
+        {
+            movie->audio_frame_primed = false;
+        }
+
+        movie->current_audio_frame = audio_frame;
+    }
+
+    /* Packets demuxed ahead belong to the old position */
+    GleedFlushPacketQueues(movie);
 }
 
 bool GleedHasNextAudioFrame(GleedMovie *movie)
@@ -523,6 +1735,12 @@ bool GleedDecodeAudioFrame(GleedMovie *movie)
         return false;
     }
 
+    if (movie->audio_frame_primed)
+    {
+        movie->audio_frame_primed = false;
+        return true;
+    }
+
     GleedReadCurrentFrame(movie, GLEED_TRACK_TYPE_AUDIO);
 
     if (movie->audio_codec == GLEED_CODEC_TYPE_VORBIS)
@@ -611,6 +1829,8 @@ bool GleedPreloadAudioStream(GleedMovie *movie)
 
     Uint32 offset = 0;
 
+    SDL_LockMutex(movie->io_lock);
+
     for (Uint32 frame = 0; frame < audio_track->total_frames; frame++)
     {
         CachedMovieFrame *frame_data = &movie->cached_frames[movie->current_audio_track][frame];
@@ -624,6 +1844,43 @@ bool GleedPreloadAudioStream(GleedMovie *movie)
         SDL_assert(offset <= buffer_size);
     }
 
+    SDL_UnlockMutex(movie->io_lock);
+
+    return true;
+}
+
+bool GleedPreloadVideoStream(GleedMovie *movie, Uint64 window_ms)
+{
+    if (!movie)
+    {
+        return GleedSetError("movie is NULL");
+    }
+
+    if (window_ms > 0 && movie->current_video_track == GLEED_NO_TRACK)
+    {
+        return GleedSetError("No video track selected for preload");
+    }
+
+    SDL_LockMutex(movie->io_lock);
+
+    movie->video_window_ms = window_ms;
+
+    /* Window is filled on the next video frame read */
+    GleedDiscardVideoWindow(movie);
+
+    if (window_ms == 0)
+    {
+        SDL_free(movie->video_window_buffer);
+        movie->video_window_buffer = NULL;
+        movie->video_window_capacity = 0;
+
+        SDL_free(movie->video_prefetch_buffer);
+        movie->video_prefetch_buffer = NULL;
+        movie->video_prefetch_capacity = 0;
+    }
+
+    SDL_UnlockMutex(movie->io_lock);
+
     return true;
 }
 
@@ -0,0 +1,345 @@
+#include "gleed_movie_internal.h"
+
+/* Size of each async read while parsing, only the chunks the parser touches are read */
+#define GLEED_ASYNC_OPEN_CHUNK_SIZE (256 * 1024)
+
+/* Reads the file through SDL async I/O one chunk at a time, serving the parser as a regular SDL_IOStream */
+typedef struct
+{
+    SDL_AsyncIO *file;       /**< File being parsed */
+    SDL_AsyncIOQueue *queue; /**< Queue receiving results of chunk reads */
+    Sint64 size;             /**< File size in bytes */
+    Sint64 position;         /**< Stream position the parser is at */
+
+    Uint8 *chunk;        /**< Chunk of the file read last */
+    Uint64 chunk_offset; /**< File offset of the chunk */
+    size_t chunk_size;   /**< Number of valid bytes in the chunk */
+
+    char error[512]; /**< Reason of the first failed read, the parser only sees a short read */
+} GleedAsyncFileReader;
+
+struct GleedAsyncOpen
+{
+    SDL_Thread *worker;           /**< Worker thread parsing the file */
+    SDL_AtomicInt status;         /**< GleedAsyncOpenStatus, written by worker */
+    bool prepare;                 /**< Also prepare the movie for playback on the worker */
+    char *file;                   /**< Path of the movie file, opened again for playback once parsed */
+    GleedAsyncFileReader reader;  /**< Reader used by the parser */
+
+    GleedMovie *movie; /**< Parsed movie, valid once status is GLEED_ASYNC_OPEN_DONE */
+    char error[1024];  /**< Error message of the worker thread, valid once status is GLEED_ASYNC_OPEN_FAILED */
+};
+
+/* Reads the chunk containing given file position */
+static bool GleedReadAsyncChunk(GleedAsyncFileReader *reader, Sint64 position)
+{
+    const Uint64 offset = (Uint64)position - (Uint64)position % GLEED_ASYNC_OPEN_CHUNK_SIZE;
+    const Uint64 size = SDL_min((Uint64)GLEED_ASYNC_OPEN_CHUNK_SIZE, (Uint64)reader->size - offset);
+
+    reader->chunk_size = 0;
+
+    if (!SDL_ReadAsyncIO(reader->file, reader->chunk, offset, size, reader->queue, NULL))
+    {
+        SDL_snprintf(reader->error, sizeof(reader->error), "Failed to start reading at %llu: %s", (unsigned long long)offset, SDL_GetError());
+        return false;
+    }
+
+    SDL_AsyncIOOutcome outcome;
+    SDL_zero(outcome);
+
+    if (!SDL_WaitAsyncIOResult(reader->queue, &outcome, -1))
+    {
+        SDL_snprintf(reader->error, sizeof(reader->error), "Failed to wait for read at %llu: %s", (unsigned long long)offset, SDL_GetError());
+        return false;
+    }
+
+    /* Read itself runs on SDL's I/O thread, whose error is not visible here, so we describe the outcome instead */
+    if (outcome.result != SDL_ASYNCIO_COMPLETE || outcome.bytes_transferred == 0)
+    {
+        SDL_snprintf(reader->error, sizeof(reader->error), "Read at %llu %s after %llu bytes", (unsigned long long)offset,
+                     outcome.result == SDL_ASYNCIO_CANCELED ? "was canceled" : "failed",
+                     (unsigned long long)outcome.bytes_transferred);
+        return false;
+    }
+
+    reader->chunk_offset = offset;
+    reader->chunk_size = (size_t)outcome.bytes_transferred;
+
+    return true;
+}
+
+static Sint64 SDLCALL GleedAsyncReaderSize(void *userdata)
+{
+    return ((GleedAsyncFileReader *)userdata)->size;
+}
+
+static Sint64 SDLCALL GleedAsyncReaderSeek(void *userdata, Sint64 offset, SDL_IOWhence whence)
+{
+    GleedAsyncFileReader *reader = (GleedAsyncFileReader *)userdata;
+
+    Sint64 position = offset;
+
+    if (whence == SDL_IO_SEEK_CUR)
+    {
+        position += reader->position;
+    }
+    else if (whence == SDL_IO_SEEK_END)
+    {
+        position += reader->size;
+    }
+
+    if (position < 0)
+    {
+        SDL_SetError("Seek before the start of the file");
+        return -1;
+    }
+
+    reader->position = position;
+
+    return position;
+}
+
+static size_t SDLCALL GleedAsyncReaderRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status)
+{
+    GleedAsyncFileReader *reader = (GleedAsyncFileReader *)userdata;
+
+    Uint8 *dst = (Uint8 *)ptr;
+    size_t done = 0;
+
+    while (done < size)
+    {
+        if (reader->position >= reader->size)
+        {
+            *status = SDL_IO_STATUS_EOF;
+            break;
+        }
+
+        const bool in_chunk = reader->chunk_size > 0 &&
+                              (Uint64)reader->position >= reader->chunk_offset &&
+                              (Uint64)reader->position - reader->chunk_offset < reader->chunk_size;
+
+        if (!in_chunk && !GleedReadAsyncChunk(reader, reader->position))
+        {
+            *status = SDL_IO_STATUS_ERROR;
+            break;
+        }
+
+        const size_t chunk_pos = (size_t)((Uint64)reader->position - reader->chunk_offset);
+        const size_t count = SDL_min(size - done, reader->chunk_size - chunk_pos);
+
+        SDL_memcpy(dst + done, reader->chunk + chunk_pos, count);
+
+        done += count;
+        reader->position += count;
+    }
+
+    return done;
+}
+
+/* Waits for the file to be closed, so no task is left on the queue */
+static void GleedCloseAsyncFile(GleedAsyncFileReader *reader)
+{
+    if (!reader->file)
+        return;
+
+    if (SDL_CloseAsyncIO(reader->file, false, reader->queue, NULL))
+    {
+        SDL_AsyncIOOutcome outcome;
+        SDL_WaitAsyncIOResult(reader->queue, &outcome, -1);
+    }
+
+    reader->file = NULL;
+}
+
+static void GleedFailAsyncOpen(GleedAsyncOpen *op, const char *fmt, const char *detail)
+{
+    SDL_snprintf(op->error, sizeof(op->error), fmt, op->file, detail);
+    SDL_SetAtomicInt(&op->status, GLEED_ASYNC_OPEN_FAILED);
+}
+
+static int GleedAsyncOpenWorker(void *data)
+{
+    GleedAsyncOpen *op = (GleedAsyncOpen *)data;
+    GleedAsyncFileReader *reader = &op->reader;
+
+    SDL_IOStreamInterface iface;
+    SDL_INIT_INTERFACE(&iface);
+    iface.size = GleedAsyncReaderSize;
+    iface.seek = GleedAsyncReaderSeek;
+    iface.read = GleedAsyncReaderRead;
+
+    SDL_IOStream *parse_io = SDL_OpenIO(&iface, reader);
+
+    if (!parse_io)
+    {
+        GleedFailAsyncOpen(op, "Failed to create stream for movie file %s: %s", SDL_GetError());
+        GleedCloseAsyncFile(reader);
+        return 0;
+    }
+
+    GleedMovie *movie = GleedOpenIO(parse_io);
+
+    /* Reader knows better why parsing stopped short */
+    if (!movie)
+    {
+        GleedFailAsyncOpen(op, "Failed to parse movie file %s: %s", reader->error[0] ? reader->error : GleedGetError());
+        SDL_CloseIO(parse_io);
+        GleedCloseAsyncFile(reader);
+        return 0;
+    }
+
+    /* Frames are read on demand during playback, so the movie keeps a regular file stream instead of memory */
+    SDL_IOStream *playback_io = SDL_IOFromFile(op->file, "rb");
+
+    if (!playback_io)
+    {
+        GleedFailAsyncOpen(op, "Failed to open movie file %s for playback: %s", SDL_GetError());
+        GleedFreeMovie(movie, true);
+        GleedCloseAsyncFile(reader);
+        return 0;
+    }
+
+    SDL_CloseIO(parse_io);
+    GleedCloseAsyncFile(reader);
+
+    movie->io = playback_io;
+    movie->owns_io = true;
+    movie->file_path = SDL_strdup(op->file);
+
+    if (op->prepare && !GleedPrepareMovie(movie))
+    {
+        /* Errors are per thread, so we carry it over to the one which finishes the open */
+        GleedFailAsyncOpen(op, "Failed to prepare movie %s: %s", GleedGetError());
+        GleedFreeMovie(movie, true);
+        return 0;
+    }
+
+    op->movie = movie;
+
+    SDL_SetAtomicInt(&op->status, GLEED_ASYNC_OPEN_DONE);
+
+    return 0;
+}
+
+static void GleedFreeAsyncOpen(GleedAsyncOpen *op)
+{
+    GleedCloseAsyncFile(&op->reader);
+
+    if (op->reader.queue)
+    {
+        SDL_DestroyAsyncIOQueue(op->reader.queue);
+    }
+
+    SDL_free(op->reader.chunk);
+    SDL_free(op->file);
+    SDL_free(op);
+}
+
+static GleedAsyncOpen *GleedStartOpenAsync(const char *file, bool prepare)
+{
+    if (!file)
+    {
+        GleedSetError("file cannot be NULL");
+        return NULL;
+    }
+
+    GleedAsyncOpen *op = (GleedAsyncOpen *)SDL_calloc(1, sizeof(GleedAsyncOpen));
+
+    if (!op)
+    {
+        GleedSetError("Failed to allocate memory for async open");
+        return NULL;
+    }
+
+    SDL_SetAtomicInt(&op->status, GLEED_ASYNC_OPEN_PENDING);
+    op->prepare = prepare;
+    op->file = SDL_strdup(file);
+    op->reader.chunk = (Uint8 *)SDL_malloc(GLEED_ASYNC_OPEN_CHUNK_SIZE);
+
+    if (!op->file || !op->reader.chunk)
+    {
+        GleedSetError("Failed to allocate memory for async open");
+        GleedFreeAsyncOpen(op);
+        return NULL;
+    }
+
+    op->reader.queue = SDL_CreateAsyncIOQueue();
+
+    if (!op->reader.queue)
+    {
+        GleedSetError("Failed to create async IO queue: %s", SDL_GetError());
+        GleedFreeAsyncOpen(op);
+        return NULL;
+    }
+
+    /* Opening itself is quick, and failing here reports a missing file right away */
+    op->reader.file = SDL_AsyncIOFromFile(file, "r");
+
+    if (!op->reader.file)
+    {
+        GleedSetError("Failed to open movie file %s: %s", file, SDL_GetError());
+        GleedFreeAsyncOpen(op);
+        return NULL;
+    }
+
+    op->reader.size = SDL_GetAsyncIOSize(op->reader.file);
+
+    if (op->reader.size < 0)
+    {
+        GleedSetError("Failed to get size of movie file %s: %s", file, SDL_GetError());
+        GleedFreeAsyncOpen(op);
+        return NULL;
+    }
+
+    op->worker = SDL_CreateThread(GleedAsyncOpenWorker, "GleedOpenAsync", op);
+
+    if (!op->worker)
+    {
+        GleedSetError("Failed to create async open thread: %s", SDL_GetError());
+        GleedFreeAsyncOpen(op);
+        return NULL;
+    }
+
+    return op;
+}
+
+GleedAsyncOpen *GleedOpenAsync(const char *file)
+{
+    return GleedStartOpenAsync(file, false);
+}
+
+GleedAsyncOpen *GleedOpenAsyncPrepared(const char *file)
+{
+    return GleedStartOpenAsync(file, true);
+}
+
+GleedAsyncOpenStatus GleedGetAsyncOpenStatus(GleedAsyncOpen *op)
+{
+    if (!op)
+        return GLEED_ASYNC_OPEN_FAILED;
+
+    return (GleedAsyncOpenStatus)SDL_GetAtomicInt(&op->status);
+}
+
+GleedMovie *GleedFinishOpenAsync(GleedAsyncOpen *op)
+{
+    if (!op)
+    {
+        GleedSetError("Async open handle cannot be NULL");
+        return NULL;
+    }
+
+    SDL_WaitThread(op->worker, NULL);
+
+    GleedMovie *movie = op->movie;
+
+    if (SDL_GetAtomicInt(&op->status) == GLEED_ASYNC_OPEN_FAILED)
+    {
+        GleedSetError("%s", op->error);
+        movie = NULL;
+    }
+
+    GleedFreeAsyncOpen(op);
+
+    return movie;
+}
@@ -0,0 +1,248 @@
+#include "gleed_movie_internal.h"
+
+typedef struct
+{
+    GleedMoviePlayer *player; /**< Player rendering into this tile */
+    SDL_Rect rect;            /**< Tile region inside the atlas */
+} GleedVideoAtlasTile;
+
+struct GleedVideoAtlas
+{
+    SDL_Texture *texture; /**< Atlas streaming texture, owned by atlas */
+    SDL_Surface *staging; /**< CPU copy of the atlas, tiles are gathered here before one upload */
+
+    GleedVideoAtlasTile *tiles; /**< Tiles allocated in the atlas */
+    int tiles_count;            /**< Number of tiles */
+    int tiles_capacity;         /**< Capacity of tiles array (vector-like allocation) */
+
+    /* Simple shelf packing: tiles are placed left to right in rows (shelves) as tall as the tallest tile in them */
+    int shelf_x;      /**< Next free X position in the current shelf */
+    int shelf_y;      /**< Y position of the current shelf */
+    int shelf_height; /**< Height of the current shelf */
+};
+
+GleedVideoAtlas *GleedCreateVideoAtlas(SDL_Renderer *renderer, int w, int h)
+{
+    if (!renderer || w <= 0 || h <= 0)
+    {
+        GleedSetError("Renderer cannot be NULL and atlas size must be positive");
+        return NULL;
+    }
+
+    GleedVideoAtlas *atlas = (GleedVideoAtlas *)SDL_calloc(1, sizeof(GleedVideoAtlas));
+
+    if (!atlas)
+    {
+        GleedSetError("Failed to allocate memory for video atlas");
+        return NULL;
+    }
+
+    atlas->texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_RGB24,
+        SDL_TEXTUREACCESS_STREAMING,
+        w,
+        h);
+
+    if (!atlas->texture)
+    {
+        GleedSetError("Failed to create atlas texture: %s", SDL_GetError());
+        SDL_free(atlas);
+        return NULL;
+    }
+
+    atlas->staging = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGB24);
+
+    if (!atlas->staging)
+    {
+        GleedSetError("Failed to create atlas staging surface: %s", SDL_GetError());
+        SDL_DestroyTexture(atlas->texture);
+        SDL_free(atlas);
+        return NULL;
+    }
+
+    return atlas;
+}
+
+void GleedFreeVideoAtlas(GleedVideoAtlas *atlas)
+{
+    if (!atlas)
+        return;
+
+    SDL_DestroyTexture(atlas->texture);
+    SDL_DestroySurface(atlas->staging);
+    SDL_free(atlas->tiles);
+    SDL_free(atlas);
+}
+
+SDL_Texture *GleedGetVideoAtlasTexture(GleedVideoAtlas *atlas)
+{
+    if (!atlas)
+        return NULL;
+
+    return atlas->texture;
+}
+
+bool GleedAddPlayerToAtlas(GleedVideoAtlas *atlas, GleedMoviePlayer *player, SDL_Rect *rect)
+{
+    if (!atlas || !player || !player->mov)
+    {
+        return GleedSetError("atlas and player cannot be NULL");
+    }
+
+    if (!player->mov->current_frame_surface)
+    {
+        return GleedSetError("No video playback available, check if video track is selected");
+    }
+
+    int w, h;
+    GleedGetVideoSize(player->mov, &w, &h);
+
+    const int atlas_w = atlas->staging->w;
+    const int atlas_h = atlas->staging->h;
+
+    /* Current shelf is full, start a new one below it */
+    if (atlas->shelf_x + w > atlas_w)
+    {
+        atlas->shelf_y += atlas->shelf_height;
+        atlas->shelf_x = 0;
+        atlas->shelf_height = 0;
+    }
+
+    if (w > atlas_w || atlas->shelf_y + h > atlas_h)
+    {
+        return GleedSetError("Not enough free space in atlas for %dx%d video", w, h);
+    }
+
+    if (atlas->tiles_count >= atlas->tiles_capacity)
+    {
+        const int new_capacity = atlas->tiles_capacity ? atlas->tiles_capacity * 2 : 16;
+
+        GleedVideoAtlasTile *new_tiles = (GleedVideoAtlasTile *)SDL_realloc(atlas->tiles, new_capacity * sizeof(GleedVideoAtlasTile));
+
+        if (!new_tiles)
+        {
+            return GleedSetError("Failed to allocate memory for atlas tiles");
+        }
+
+        atlas->tiles = new_tiles;
+        atlas->tiles_capacity = new_capacity;
+    }
+
+    GleedVideoAtlasTile *tile = &atlas->tiles[atlas->tiles_count++];
+
+    tile->player = player;
+    tile->rect.x = atlas->shelf_x;
+    tile->rect.y = atlas->shelf_y;
+    tile->rect.w = w;
+    tile->rect.h = h;
+
+    atlas->shelf_x += w;
+    atlas->shelf_height = SDL_max(atlas->shelf_height, h);
+
+    /* Make sure the tile receives the current frame on the next atlas update */
+    player->atlas_frame_pending = true;
+
+    if (rect)
+    {
+        *rect = tile->rect;
+    }
+
+    return true;
+}
+
+void GleedRemovePlayerFromAtlas(GleedVideoAtlas *atlas, GleedMoviePlayer *player)
+{
+    if (!atlas || !player)
+        return;
+
+    for (int i = 0; i < atlas->tiles_count; i++)
+    {
+        if (atlas->tiles[i].player == player)
+        {
+            /* The region is not reclaimed, but the tile will no longer be updated */
+            atlas->tiles[i].player = NULL;
+        }
+    }
+}
+
+/* Uploads given part of the staging surface into the atlas texture */
+static bool GleedUploadAtlasRect(GleedVideoAtlas *atlas, const SDL_Rect *rect)
+{
+    const Uint8 *pixels = (const Uint8 *)atlas->staging->pixels + rect->y * atlas->staging->pitch + rect->x * SDL_BYTESPERPIXEL(atlas->staging->format);
+
+    if (!SDL_UpdateTexture(atlas->texture, rect, pixels, atlas->staging->pitch))
+    {
+        return GleedSetError("Failed to update atlas texture: %s", SDL_GetError());
+    }
+
+    return true;
+}
+
+bool GleedUpdateVideoAtlas(GleedVideoAtlas *atlas)
+{
+    if (!atlas)
+    {
+        return GleedSetError("atlas cannot be NULL");
+    }
+
+    /*
+        Updated tiles next to each other on the same shelf are uploaded as one rectangle. Tiles anywhere else
+        are uploaded on their own, as a bounding box of distant tiles would re-upload most of the atlas.
+    */
+    SDL_Rect run = {0, 0, 0, 0};
+    bool has_run = false;
+
+    for (int i = 0; i < atlas->tiles_count; i++)
+    {
+        GleedVideoAtlasTile *tile = &atlas->tiles[i];
+
+        if (!tile->player || !tile->player->atlas_frame_pending)
+        {
+            continue;
+        }
+
+        const SDL_Surface *frame = GleedGetVideoFrameSurface(tile->player->mov);
+
+        if (!frame)
+        {
+            continue;
+        }
+
+        const int row_size = SDL_min(frame->w, tile->rect.w) * SDL_BYTESPERPIXEL(frame->format);
+        const int rows = SDL_min(frame->h, tile->rect.h);
+
+        Uint8 *dst = (Uint8 *)atlas->staging->pixels + tile->rect.y * atlas->staging->pitch + tile->rect.x * SDL_BYTESPERPIXEL(atlas->staging->format);
+        const Uint8 *src = (const Uint8 *)frame->pixels;
+
+        for (int y = 0; y < rows; y++)
+        {
+            SDL_memcpy(dst + y * atlas->staging->pitch, src + y * frame->pitch, row_size);
+        }
+
+        tile->player->atlas_frame_pending = false;
+
+        /* Staging surface holds valid pixels below shorter tiles of the shelf too, so the run may take the taller height */
+        if (has_run && run.y == tile->rect.y && run.x + run.w == tile->rect.x)
+        {
+            run.w += tile->rect.w;
+            run.h = SDL_max(run.h, tile->rect.h);
+            continue;
+        }
+
+        if (has_run && !GleedUploadAtlasRect(atlas, &run))
+        {
+            return false;
+        }
+
+        run = tile->rect;
+        has_run = true;
+    }
+
+    if (has_run)
+    {
+        return GleedUploadAtlasRect(atlas, &run);
+    }
+
+    return true;
+}
@@ -0,0 +1,150 @@
+#include "gleed_movie_internal.h"
+
+/*
+    VP8 frame tag: the lowest bit of the first byte is frame type, 0 meaning keyframe.
+*/
+static bool GleedIsVP8KeyFrame(const Uint8 *data, Uint32 size, bool *key_frame)
+{
+    if (size < 3)
+    {
+        return false;
+    }
+
+    *key_frame = (data[0] & 0x01) == 0;
+
+    return true;
+}
+
+/*
+    VP9 uncompressed header starts with frame_marker (2 bits), profile (2 bits, plus reserved bit for profile 3),
+    show_existing_frame and frame_type, 0 meaning keyframe. Superframes start with their first frame header.
+*/
+static bool GleedIsVP9KeyFrame(const Uint8 *data, Uint32 size, bool *key_frame)
+{
+    if (size < 1 || (data[0] >> 6) != 0x02)
+    {
+        return false;
+    }
+
+    const int profile = ((data[0] >> 5) & 0x01) | (((data[0] >> 4) & 0x01) << 1);
+
+    int bit = profile == 3 ? 2 : 3;
+
+    const bool show_existing_frame = (data[0] >> bit) & 0x01;
+
+    bit--;
+
+    if (show_existing_frame)
+    {
+        *key_frame = false;
+        return true;
+    }
+
+    *key_frame = ((data[0] >> bit) & 0x01) == 0;
+
+    return true;
+}
+
+static bool GleedReadLeb128(const Uint8 **data, const Uint8 *end, Uint64 *value)
+{
+    *value = 0;
+
+    for (int i = 0; i < 8 && *data < end; i++)
+    {
+        const Uint8 byte = *(*data)++;
+
+        *value |= (Uint64)(byte & 0x7f) << (i * 7);
+
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+    AV1 temporal unit is a sequence of OBUs; we look for the first frame header
+    and read its show_existing_frame and frame_type (2 bits, 0 meaning keyframe).
+
+    Reduced still picture headers are not supported, as they are not used in WebM.
+*/
+static bool GleedIsAV1KeyFrame(const Uint8 *data, Uint32 size, bool *key_frame)
+{
+    const Uint8 OBU_FRAME_HEADER = 3;
+    const Uint8 OBU_FRAME = 6;
+
+    const Uint8 *ptr = data;
+    const Uint8 *end = data + size;
+
+    while (ptr < end)
+    {
+        const Uint8 header = *ptr++;
+        const Uint8 obu_type = (header >> 3) & 0x0f;
+        const bool has_extension = (header >> 2) & 0x01;
+        const bool has_size = (header >> 1) & 0x01;
+
+        if (has_extension)
+        {
+            ptr++;
+        }
+
+        Uint64 obu_size = (Uint64)(end - ptr);
+
+        if (has_size && !GleedReadLeb128(&ptr, end, &obu_size))
+        {
+            return false;
+        }
+
+        if (ptr >= end)
+        {
+            return false;
+        }
+
+        /* Only the first byte of frame header is needed, so data may be just the beginning of the frame */
+        if (obu_type == OBU_FRAME_HEADER || obu_type == OBU_FRAME)
+        {
+            const bool show_existing_frame = (ptr[0] >> 7) & 0x01;
+            const int frame_type = (ptr[0] >> 5) & 0x03;
+
+            *key_frame = !show_existing_frame && frame_type == 0;
+
+            return true;
+        }
+
+        if (obu_size >= (Uint64)(end - ptr))
+        {
+            return false;
+        }
+
+        ptr += obu_size;
+    }
+
+    return false;
+}
+
+bool GleedDetectKeyFrame(GleedMovieCodecType codec, const Uint8 *data, Uint32 size, bool *key_frame)
+{
+    if (!data || size == 0)
+    {
+        return false;
+    }
+
+    switch (codec)
+    {
+    case GLEED_CODEC_TYPE_VP8:
+        return GleedIsVP8KeyFrame(data, size, key_frame);
+    case GLEED_CODEC_TYPE_VP9:
+        return GleedIsVP9KeyFrame(data, size, key_frame);
+    case GLEED_CODEC_TYPE_AV1:
+        return GleedIsAV1KeyFrame(data, size, key_frame);
+    case GLEED_CODEC_TYPE_VORBIS:
+    case GLEED_CODEC_TYPE_OPUS:
+        /* Every audio packet of these codecs can be decoded on its own */
+        *key_frame = true;
+        return true;
+    default:
+        return false;
+    }
+}
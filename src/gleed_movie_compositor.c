@@ -0,0 +1,303 @@
+#include "gleed_movie_internal.h"
+
+/* Blends count bytes of a and b into dst, weight is the share of b in 0..256 range */
+typedef void (*GleedBlendRowFunc)(Uint8 *dst, const Uint8 *a, const Uint8 *b, int count, int weight);
+
+struct GleedVideoCompositor
+{
+    SDL_Texture *texture; /**< Output streaming texture, owned by compositor */
+    int width;            /**< Width of composed frames */
+    int height;           /**< Height of composed frames */
+
+    Uint8 *yuv_buffer;           /**< Composed frame, tightly packed IYUV planes */
+    GleedBlendRowFunc blend_row; /**< Fastest blending kernel supported by the CPU */
+};
+
+static void GleedBlendRowScalar(Uint8 *dst, const Uint8 *a, const Uint8 *b, int count, int weight)
+{
+    const int inverse_weight = 256 - weight;
+
+    for (int i = 0; i < count; i++)
+    {
+        dst[i] = (Uint8)((a[i] * inverse_weight + b[i] * weight + 128) >> 8);
+    }
+}
+
+#ifdef SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") GleedBlendRowSSE2(Uint8 *dst, const Uint8 *a, const Uint8 *b, int count, int weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(128);
+    const __m128i weight_a = _mm_set1_epi16((short)(256 - weight));
+    const __m128i weight_b = _mm_set1_epi16((short)weight);
+
+    int i = 0;
+
+    /* Both weighted samples add up to at most 255 * 256, so 16-bit lanes never overflow */
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+
+        __m128i lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), weight_a),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), weight_b));
+
+        __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), weight_a),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), weight_b));
+
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, rounding), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, rounding), 8);
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    GleedBlendRowScalar(dst + i, a + i, b + i, count - i, weight);
+}
+#endif
+
+#ifdef SDL_NEON_INTRINSICS
+static void GleedBlendRowNEON(Uint8 *dst, const Uint8 *a, const Uint8 *b, int count, int weight)
+{
+    const uint16_t weight_a = (uint16_t)(256 - weight);
+    const uint16_t weight_b = (uint16_t)weight;
+
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        const uint8x16_t va = vld1q_u8(a + i);
+        const uint8x16_t vb = vld1q_u8(b + i);
+
+        uint16x8_t lo = vmulq_n_u16(vmovl_u8(vget_low_u8(va)), weight_a);
+        uint16x8_t hi = vmulq_n_u16(vmovl_u8(vget_high_u8(va)), weight_a);
+
+        lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(vb)), weight_b);
+        hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(vb)), weight_b);
+
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+
+    GleedBlendRowScalar(dst + i, a + i, b + i, count - i, weight);
+}
+#endif
+
+static GleedBlendRowFunc GleedSelectBlendRow(void)
+{
+#ifdef SDL_SSE2_INTRINSICS
+    if (SDL_HasSSE2())
+    {
+        return GleedBlendRowSSE2;
+    }
+#endif
+
+#ifdef SDL_NEON_INTRINSICS
+    if (SDL_HasNEON())
+    {
+        return GleedBlendRowNEON;
+    }
+#endif
+
+    return GleedBlendRowScalar;
+}
+
+GleedVideoCompositor *GleedCreateVideoCompositor(SDL_Renderer *renderer, int w, int h)
+{
+    if (!renderer || w <= 0 || h <= 0)
+    {
+        GleedSetError("Renderer cannot be NULL and compositor size must be positive");
+        return NULL;
+    }
+
+    GleedVideoCompositor *compositor = (GleedVideoCompositor *)SDL_calloc(1, sizeof(GleedVideoCompositor));
+
+    if (!compositor)
+    {
+        GleedSetError("Failed to allocate memory for video compositor");
+        return NULL;
+    }
+
+    compositor->width = w;
+    compositor->height = h;
+    compositor->blend_row = GleedSelectBlendRow();
+
+    const size_t chroma_size = (size_t)((w + 1) / 2) * ((h + 1) / 2);
+
+    compositor->yuv_buffer = (Uint8 *)SDL_malloc((size_t)w * h + 2 * chroma_size);
+
+    if (!compositor->yuv_buffer)
+    {
+        GleedSetError("Failed to allocate video compositor buffer");
+        SDL_free(compositor);
+        return NULL;
+    }
+
+    compositor->texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_RGB24,
+        SDL_TEXTUREACCESS_STREAMING,
+        w,
+        h);
+
+    if (!compositor->texture)
+    {
+        GleedSetError("Failed to create compositor texture: %s", SDL_GetError());
+        SDL_free(compositor->yuv_buffer);
+        SDL_free(compositor);
+        return NULL;
+    }
+
+    return compositor;
+}
+
+void GleedFreeVideoCompositor(GleedVideoCompositor *compositor)
+{
+    if (!compositor)
+        return;
+
+    SDL_DestroyTexture(compositor->texture);
+    SDL_free(compositor->yuv_buffer);
+    SDL_free(compositor);
+}
+
+SDL_Texture *GleedGetVideoCompositorTexture(GleedVideoCompositor *compositor)
+{
+    if (!compositor)
+        return NULL;
+
+    return compositor->texture;
+}
+
+/*
+    Gets the last decoded frame of the player with chroma planes always in U, V order.
+    Both frames are assumed to share the colorspace, so it's only taken from one of them.
+*/
+static bool GleedGetPlayerDecodedPlanes(GleedVideoCompositor *compositor, GleedMoviePlayer *player, const Uint8 *planes[3], int strides[3], SDL_Colorspace *colorspace)
+{
+    if (!player || !player->mov || !player->mov->has_decoded_video_frame)
+    {
+        return GleedSetError("Player has no decoded video frame");
+    }
+
+    const DecodedVideoFrame *frame = &player->mov->decoded_video_frame;
+
+    if (frame->width != compositor->width || frame->height != compositor->height)
+    {
+        return GleedSetError("Player video size %dx%d does not match compositor size %dx%d", frame->width, frame->height, compositor->width, compositor->height);
+    }
+
+    /* YV12 only differs from IYUV by chroma planes order */
+    const bool swap_chroma = frame->format == SDL_PIXELFORMAT_YV12;
+
+    planes[0] = frame->planes[0];
+    planes[1] = frame->planes[swap_chroma ? 2 : 1];
+    planes[2] = frame->planes[swap_chroma ? 1 : 2];
+
+    strides[0] = frame->strides[0];
+    strides[1] = frame->strides[swap_chroma ? 2 : 1];
+    strides[2] = frame->strides[swap_chroma ? 1 : 2];
+
+    if (colorspace)
+    {
+        *colorspace = frame->colorspace;
+    }
+
+    return true;
+}
+
+bool GleedComposePlayers(
+    GleedVideoCompositor *compositor,
+    GleedMoviePlayer *from,
+    GleedMoviePlayer *to,
+    GleedVideoTransition transition,
+    float progress)
+{
+    if (!compositor)
+    {
+        return GleedSetError("Compositor cannot be NULL");
+    }
+
+    const Uint8 *from_planes[3];
+    const Uint8 *to_planes[3];
+    int from_strides[3];
+    int to_strides[3];
+    SDL_Colorspace colorspace;
+
+    if (!GleedGetPlayerDecodedPlanes(compositor, from, from_planes, from_strides, &colorspace) ||
+        !GleedGetPlayerDecodedPlanes(compositor, to, to_planes, to_strides, NULL))
+    {
+        return false;
+    }
+
+    progress = SDL_clamp(progress, 0.0f, 1.0f);
+
+    const int weight = (int)(progress * 256.0f + 0.5f);
+
+    Uint8 *write_ptr = compositor->yuv_buffer;
+
+    /* Frames are blended while still in YUV, so only the result goes through the (expensive) RGB conversion */
+    for (int plane = 0; plane < 3; plane++)
+    {
+        const int plane_width = plane == 0 ? compositor->width : (compositor->width + 1) / 2;
+        const int plane_height = plane == 0 ? compositor->height : (compositor->height + 1) / 2;
+
+        /* Wipe edge position, everything before it is already showing the new frame */
+        const int edge_x = (int)(progress * plane_width);
+        const int edge_y = (int)(progress * plane_height);
+
+        for (int y = 0; y < plane_height; y++)
+        {
+            const Uint8 *from_row = from_planes[plane] + y * from_strides[plane];
+            const Uint8 *to_row = to_planes[plane] + y * to_strides[plane];
+
+            switch (transition)
+            {
+            case GLEED_VIDEO_TRANSITION_WIPE_HORIZONTAL:
+                SDL_memcpy(write_ptr, to_row, edge_x);
+                SDL_memcpy(write_ptr + edge_x, from_row + edge_x, plane_width - edge_x);
+                break;
+            case GLEED_VIDEO_TRANSITION_WIPE_VERTICAL:
+                SDL_memcpy(write_ptr, y < edge_y ? to_row : from_row, plane_width);
+                break;
+            case GLEED_VIDEO_TRANSITION_CROSSFADE:
+            default:
+                compositor->blend_row(write_ptr, from_row, to_row, plane_width, weight);
+                break;
+            }
+
+            write_ptr += plane_width;
+        }
+    }
+
+    void *pixels;
+    int pitch;
+
+    if (!SDL_LockTexture(compositor->texture, NULL, &pixels, &pitch))
+    {
+        return GleedSetError("Failed to lock compositor texture: %s", SDL_GetError());
+    }
+
+    const bool converted = SDL_ConvertPixelsAndColorspace(
+        compositor->width,
+        compositor->height,
+        SDL_PIXELFORMAT_IYUV,
+        colorspace,
+        0,
+        compositor->yuv_buffer,
+        compositor->width,
+        SDL_PIXELFORMAT_RGB24,
+        SDL_COLORSPACE_SRGB,
+        0,
+        pixels,
+        pitch);
+
+    SDL_UnlockTexture(compositor->texture);
+
+    if (!converted)
+    {
+        return GleedSetError("Failed to convert composed frame: %s", SDL_GetError());
+    }
+
+    return true;
+}
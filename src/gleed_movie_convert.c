@@ -0,0 +1,486 @@
+#include "gleed_movie_internal.h"
+
+/* Size of dirty detection block side in pixels, same as VPX macroblock */
+#define GLEED_DIRTY_BLOCK_SIZE 16
+
+/* Smaller rectangles are converted on the calling thread, as waking up workers would cost more than it saves */
+#define GLEED_PARALLEL_CONVERSION_MIN_PIXELS (1280 * 720)
+
+/* Minimal height of a conversion slice, must be even to keep chroma rows of slices apart */
+#define GLEED_CONVERSION_SLICE_MIN_ROWS 64
+
+/*
+    Size of chroma plane side for 4:2:0 subsampled formats,
+    matches both libvpx and dav1d rounding and what SDL expects for IYUV/YV12
+*/
+static int GleedChromaSize(int size)
+{
+    return (size + 1) / 2;
+}
+
+static bool GleedEnsureConversionBuffer(GleedMovie *movie, size_t buffer_size)
+{
+    if (!movie->conversion_video_frame_buffer)
+    {
+        movie->conversion_video_frame_buffer = (Uint8 *)SDL_calloc(
+            1, buffer_size);
+        movie->conversion_video_frame_buffer_size = buffer_size;
+    }
+    else if (movie->conversion_video_frame_buffer_size < buffer_size)
+    {
+        movie->conversion_video_frame_buffer = (Uint8 *)SDL_realloc(
+            movie->conversion_video_frame_buffer, buffer_size);
+        movie->conversion_video_frame_buffer_size = buffer_size;
+    }
+
+    if (!movie->conversion_video_frame_buffer)
+    {
+        movie->conversion_video_frame_buffer_size = 0;
+        return GleedSetError("Failed to allocate video conversion buffer");
+    }
+
+    return true;
+}
+
+/*
+    Converts given rectangle of the decoded frame into the same rectangle of target pixels,
+    packing its planes into convert_buffer first. Only sets SDL error on failure, as it may run on a worker thread.
+
+    Rectangle position must be even, so that chroma planes are cropped at the exact sample.
+*/
+static bool GleedConvertFrameRectPlanes(
+    const DecodedVideoFrame *frame,
+    const SDL_Rect *rect,
+    Uint8 *convert_buffer,
+    void *dst,
+    int dst_pitch,
+    SDL_PixelFormat dst_format,
+    SDL_Colorspace dst_colorspace)
+{
+    const int chroma_x = rect->x / 2;
+    const int chroma_y = rect->y / 2;
+    const int chroma_width = GleedChromaSize(rect->w);
+    const int chroma_height = GleedChromaSize(rect->h);
+
+    Uint8 *convert_buffer_write_ptr = convert_buffer;
+
+    /*
+        Decoders give us planes with their own (padded) strides, while SDL wants one continuous buffer
+        with Y plane followed by two chroma planes, so we pack the needed part of each plane tightly.
+    */
+    for (int plane = 0; plane < 3; plane++)
+    {
+        const int plane_x = plane == 0 ? rect->x : chroma_x;
+        const int plane_y = plane == 0 ? rect->y : chroma_y;
+        const int plane_height = plane == 0 ? rect->h : chroma_height;
+        const int plane_width = plane == 0 ? rect->w : chroma_width;
+
+        for (int y = 0; y < plane_height; y++)
+        {
+            SDL_memcpy(
+                convert_buffer_write_ptr,
+                frame->planes[plane] + (plane_y + y) * frame->strides[plane] + plane_x,
+                plane_width);
+            convert_buffer_write_ptr += plane_width;
+        }
+    }
+
+    Uint8 *target_pixels = (Uint8 *)dst + rect->y * dst_pitch + rect->x * SDL_BYTESPERPIXEL(dst_format);
+
+    /* Thank you SDL for this monster helper! */
+    return SDL_ConvertPixelsAndColorspace(
+        rect->w,
+        rect->h,
+        frame->format,
+        frame->colorspace,
+        0,
+        convert_buffer,
+        rect->w,
+        dst_format,
+        dst_colorspace,
+        0,
+        target_pixels,
+        dst_pitch);
+}
+
+/* Rectangle split into horizontal slices, converted in parallel */
+typedef struct
+{
+    const DecodedVideoFrame *frame;
+    SDL_Rect rect;          /**< Whole converted rectangle */
+    int slice_rows;         /**< Height of each slice but the last one, even */
+    Uint8 *convert_buffer;  /**< Shared buffer, each slice packs its planes into its own part */
+    void *dst;
+    int dst_pitch;
+    SDL_PixelFormat dst_format;
+    SDL_Colorspace dst_colorspace;
+
+    SDL_AtomicInt failed; /**< Set by the first failed slice */
+    char error[256];      /**< SDL error of the first failed slice, as SDL errors are per thread */
+} GleedConversionSlices;
+
+static void GleedConvertSlice(void *userdata, int index)
+{
+    GleedConversionSlices *slices = (GleedConversionSlices *)userdata;
+
+    SDL_Rect slice_rect = slices->rect;
+    slice_rect.y += index * slices->slice_rows;
+    slice_rect.h = SDL_min(slices->slice_rows, slices->rect.y + slices->rect.h - slice_rect.y);
+
+    /* All previous slices are slice_rows high, and their chroma rows are exactly half of it */
+    const size_t slice_buffer_size = (size_t)slices->rect.w * slices->slice_rows + 2 * (size_t)GleedChromaSize(slices->rect.w) * (slices->slice_rows / 2);
+
+    Uint8 *slice_buffer = slices->convert_buffer + index * slice_buffer_size;
+
+    if (!GleedConvertFrameRectPlanes(slices->frame, &slice_rect, slice_buffer, slices->dst, slices->dst_pitch, slices->dst_format, slices->dst_colorspace))
+    {
+        if (SDL_CompareAndSwapAtomicInt(&slices->failed, 0, 1))
+        {
+            SDL_strlcpy(slices->error, SDL_GetError(), sizeof(slices->error));
+        }
+    }
+}
+
+/*
+    Converts given rectangle of the decoded frame into the same rectangle of target pixels.
+
+    Large rectangles of packed targets are split into horizontal slices converted on the worker pool. Slices pack their planes
+    into consecutive parts of the conversion buffer, which add up to the size of the whole rectangle planes.
+*/
+static bool GleedConvertFrameRect(
+    GleedMovie *movie,
+    const DecodedVideoFrame *frame,
+    const SDL_Rect *rect,
+    void *dst,
+    int dst_pitch,
+    SDL_PixelFormat dst_format,
+    SDL_Colorspace dst_colorspace)
+{
+    int slices_count = 1;
+
+    /* Planar (FOURCC) targets keep their chroma planes after the whole luma plane, so a slice can't be addressed by pitch alone */
+    if (rect->w * rect->h >= GLEED_PARALLEL_CONVERSION_MIN_PIXELS && !SDL_ISPIXELFORMAT_FOURCC(dst_format))
+    {
+        slices_count = SDL_min(GleedGetParallelism(), rect->h / GLEED_CONVERSION_SLICE_MIN_ROWS);
+    }
+
+    if (slices_count <= 1)
+    {
+        if (!GleedConvertFrameRectPlanes(frame, rect, movie->conversion_video_frame_buffer, dst, dst_pitch, dst_format, dst_colorspace))
+        {
+            return GleedSetError("Failed to convert video frame: %s", SDL_GetError());
+        }
+
+        return true;
+    }
+
+    GleedConversionSlices slices;
+    SDL_zero(slices);
+    slices.frame = frame;
+    slices.rect = *rect;
+    slices.convert_buffer = movie->conversion_video_frame_buffer;
+    slices.dst = dst;
+    slices.dst_pitch = dst_pitch;
+    slices.dst_format = dst_format;
+    slices.dst_colorspace = dst_colorspace;
+
+    /* Rounded up to even, which may leave fewer slices than requested */
+    slices.slice_rows = (rect->h + slices_count - 1) / slices_count;
+    slices.slice_rows += slices.slice_rows & 1;
+    slices_count = (rect->h + slices.slice_rows - 1) / slices.slice_rows;
+
+    GleedRunParallel(GleedConvertSlice, &slices, slices_count);
+
+    if (SDL_GetAtomicInt(&slices.failed))
+    {
+        return GleedSetError("Failed to convert video frame: %s", slices.error);
+    }
+
+    return true;
+}
+
+void GleedResetDirtyBlocks(GleedMovie *movie)
+{
+    SDL_free(movie->block_hashes);
+    SDL_free(movie->dirty_blocks);
+    SDL_free(movie->pending_upload_blocks);
+    SDL_free(movie->dirty_rects);
+    SDL_free(movie->upload_rects);
+
+    movie->block_hashes = NULL;
+    movie->dirty_blocks = NULL;
+    movie->pending_upload_blocks = NULL;
+    movie->dirty_rects = NULL;
+    movie->upload_rects = NULL;
+    movie->dirty_rects_count = 0;
+    movie->dirty_blocks_w = 0;
+    movie->dirty_blocks_h = 0;
+}
+
+static bool GleedPrepareDirtyBlocks(GleedMovie *movie, const DecodedVideoFrame *frame)
+{
+    const int blocks_w = (frame->width + GLEED_DIRTY_BLOCK_SIZE - 1) / GLEED_DIRTY_BLOCK_SIZE;
+    const int blocks_h = (frame->height + GLEED_DIRTY_BLOCK_SIZE - 1) / GLEED_DIRTY_BLOCK_SIZE;
+
+    if (movie->block_hashes && movie->dirty_blocks_w == blocks_w && movie->dirty_blocks_h == blocks_h)
+    {
+        return true;
+    }
+
+    GleedResetDirtyBlocks(movie);
+
+    const int blocks_count = blocks_w * blocks_h;
+
+    movie->block_hashes = (Uint64 *)SDL_calloc(blocks_count, sizeof(Uint64));
+    movie->dirty_blocks = (Uint8 *)SDL_calloc(blocks_count, sizeof(Uint8));
+    movie->pending_upload_blocks = (Uint8 *)SDL_calloc(blocks_count, sizeof(Uint8));
+    movie->dirty_rects = (SDL_Rect *)SDL_calloc(blocks_h, sizeof(SDL_Rect));
+    movie->upload_rects = (SDL_Rect *)SDL_calloc(blocks_h, sizeof(SDL_Rect));
+
+    if (!movie->block_hashes || !movie->dirty_blocks || !movie->pending_upload_blocks || !movie->dirty_rects || !movie->upload_rects)
+    {
+        GleedResetDirtyBlocks(movie);
+        return GleedSetError("Failed to allocate memory for dirty rectangles detection");
+    }
+
+    movie->dirty_blocks_w = blocks_w;
+    movie->dirty_blocks_h = blocks_h;
+
+    /* Nothing was converted or uploaded yet, so the whole frame is dirty */
+    SDL_memset(movie->pending_upload_blocks, 1, blocks_count);
+    movie->dirty_blocks_fresh = true;
+
+    return true;
+}
+
+/* FNV-1a style hash, but mixing 8 bytes at once, which is enough to notice changed pixels */
+static Uint64 GleedHashBytes(Uint64 hash, const Uint8 *data, int size)
+{
+    const Uint64 prime = 0x100000001b3ULL;
+
+    int i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        Uint64 word;
+        SDL_memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+
+    for (; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * prime;
+    }
+
+    return hash;
+}
+
+/*
+    Hashes all planes of each block and compares them with the previous frame.
+
+    Changed blocks are marked in dirty_blocks (for this frame conversion)
+    and in pending_upload_blocks (for next texture upload, as several frames can be decoded between uploads).
+*/
+static void GleedDetectDirtyBlocks(GleedMovie *movie, const DecodedVideoFrame *frame)
+{
+    const int blocks_w = movie->dirty_blocks_w;
+    const int blocks_h = movie->dirty_blocks_h;
+
+    const int chroma_block_size = GLEED_DIRTY_BLOCK_SIZE / 2;
+    const int chroma_width = GleedChromaSize(frame->width);
+    const int chroma_height = GleedChromaSize(frame->height);
+
+    for (int by = 0; by < blocks_h; by++)
+    {
+        const int y0 = by * GLEED_DIRTY_BLOCK_SIZE;
+        const int rows = SDL_min(GLEED_DIRTY_BLOCK_SIZE, frame->height - y0);
+        const int chroma_y0 = by * chroma_block_size;
+        const int chroma_rows = SDL_min(chroma_block_size, chroma_height - chroma_y0);
+
+        for (int bx = 0; bx < blocks_w; bx++)
+        {
+            const int x0 = bx * GLEED_DIRTY_BLOCK_SIZE;
+            const int cols = SDL_min(GLEED_DIRTY_BLOCK_SIZE, frame->width - x0);
+            const int chroma_x0 = bx * chroma_block_size;
+            const int chroma_cols = SDL_min(chroma_block_size, chroma_width - chroma_x0);
+
+            Uint64 hash = 0xcbf29ce484222325ULL;
+
+            for (int y = 0; y < rows; y++)
+            {
+                hash = GleedHashBytes(hash, frame->planes[0] + (y0 + y) * frame->strides[0] + x0, cols);
+            }
+
+            for (int plane = 1; plane < 3; plane++)
+            {
+                for (int y = 0; y < chroma_rows; y++)
+                {
+                    hash = GleedHashBytes(hash, frame->planes[plane] + (chroma_y0 + y) * frame->strides[plane] + chroma_x0, chroma_cols);
+                }
+            }
+
+            const int block = by * blocks_w + bx;
+
+            const bool dirty = movie->dirty_blocks_fresh || movie->block_hashes[block] != hash;
+
+            movie->block_hashes[block] = hash;
+            movie->dirty_blocks[block] = dirty;
+
+            if (dirty)
+            {
+                movie->pending_upload_blocks[block] = 1;
+            }
+        }
+    }
+
+    movie->dirty_blocks_fresh = false;
+}
+
+int GleedCollectDirtyRects(GleedMovie *movie, const Uint8 *blocks, SDL_Rect *rects)
+{
+    const int w = movie->current_frame_surface->w;
+    const int h = movie->current_frame_surface->h;
+
+    int count = 0;
+
+    /* One rectangle per block row spanning its dirty blocks, merged with the previous row if spans match */
+    for (int by = 0; by < movie->dirty_blocks_h; by++)
+    {
+        int first = -1;
+        int last = -1;
+
+        for (int bx = 0; bx < movie->dirty_blocks_w; bx++)
+        {
+            if (blocks[by * movie->dirty_blocks_w + bx])
+            {
+                if (first < 0)
+                {
+                    first = bx;
+                }
+                last = bx;
+            }
+        }
+
+        if (first < 0)
+        {
+            continue;
+        }
+
+        SDL_Rect rect;
+        rect.x = first * GLEED_DIRTY_BLOCK_SIZE;
+        rect.y = by * GLEED_DIRTY_BLOCK_SIZE;
+        rect.w = SDL_min((last + 1) * GLEED_DIRTY_BLOCK_SIZE, w) - rect.x;
+        rect.h = SDL_min(GLEED_DIRTY_BLOCK_SIZE, h - rect.y);
+
+        SDL_Rect *previous = count > 0 ? &rects[count - 1] : NULL;
+
+        if (previous && previous->x == rect.x && previous->w == rect.w && previous->y + previous->h == rect.y)
+        {
+            previous->h += rect.h;
+        }
+        else
+        {
+            rects[count++] = rect;
+        }
+    }
+
+    return count;
+}
+
+bool GleedConvertDecodedFrame(GleedMovie *movie, const DecodedVideoFrame *frame)
+{
+    /* Frame decoded ahead is converted by the next GleedDecodeVideoFrame call, while the following one decodes */
+    if (movie->defer_video_conversion)
+    {
+        movie->pipelined_video_frame = *frame;
+        movie->has_pipelined_video_frame = true;
+        return true;
+    }
+
+    /* Decoders keep the planes until their next decode call, so they can be handed out as-is */
+    movie->decoded_video_frame = *frame;
+    movie->has_decoded_video_frame = true;
+
+    return GleedConvertVideoFrame(movie, frame);
+}
+
+bool GleedConvertVideoFrame(GleedMovie *movie, const DecodedVideoFrame *frame)
+{
+    if (movie->drop_video_conversion && !movie->target_pixels)
+    {
+        /* Surface misses this frame, so dirty block hashes no longer describe it */
+        movie->dirty_blocks_fresh = true;
+        return true;
+    }
+
+    if (movie->skip_video_conversion && !movie->target_pixels)
+    {
+        return true;
+    }
+
+    const size_t buffer_size = (size_t)frame->width * frame->height + 2 * (size_t)GleedChromaSize(frame->width) * GleedChromaSize(frame->height);
+
+    if (!GleedEnsureConversionBuffer(movie, buffer_size))
+    {
+        return false;
+    }
+
+    SDL_Rect full_rect = {0, 0, frame->width, frame->height};
+
+    /*
+        Caller-owned target gets the whole frame, and the frame surface is left untouched,
+        so dirty block hashes keep describing what the surface holds.
+    */
+    if (movie->target_pixels)
+    {
+        const SDL_Colorspace target_colorspace = SDL_ISPIXELFORMAT_FOURCC(movie->target_format) ? frame->colorspace : SDL_COLORSPACE_SRGB;
+
+        return GleedConvertFrameRect(movie, frame, &full_rect, movie->target_pixels, movie->target_pitch, movie->target_format, target_colorspace);
+    }
+
+    if (!movie->current_frame_surface)
+    {
+        movie->current_frame_surface = SDL_CreateSurface(
+            frame->width,
+            frame->height,
+            SDL_PIXELFORMAT_RGB24);
+
+        if (!movie->current_frame_surface)
+        {
+            return GleedSetError("Failed to create video frame surface: %s", SDL_GetError());
+        }
+    }
+
+    SDL_Surface *surface = movie->current_frame_surface;
+    const SDL_Colorspace surface_colorspace = SDL_GetSurfaceColorspace(surface);
+
+    SDL_LockSurface(surface);
+
+    bool converted = true;
+
+    if (movie->dirty_rects_enabled && GleedPrepareDirtyBlocks(movie, frame))
+    {
+        GleedDetectDirtyBlocks(movie, frame);
+
+        movie->dirty_rects_count = GleedCollectDirtyRects(movie, movie->dirty_blocks, movie->dirty_rects);
+
+        for (int i = 0; i < movie->dirty_rects_count && converted; i++)
+        {
+            converted = GleedConvertFrameRect(movie, frame, &movie->dirty_rects[i], surface->pixels, surface->pitch, surface->format, surface_colorspace);
+        }
+
+        /* Hashes already describe this frame, but some of its blocks never made it to the surface */
+        if (!converted)
+        {
+            movie->dirty_blocks_fresh = true;
+        }
+    }
+    else
+    {
+        converted = GleedConvertFrameRect(movie, frame, &full_rect, surface->pixels, surface->pitch, surface->format, surface_colorspace);
+    }
+
+    SDL_UnlockSurface(surface);
+
+    return converted;
+}
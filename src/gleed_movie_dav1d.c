@@ -0,0 +1,338 @@
+#include "gleed_movie_internal.h"
+
+#include <dav1d/dav1d.h>
+
+typedef struct
+{
+    Dav1dContext *decoder;
+    Uint64 pool_key;      /**< Options the decoder was opened with */
+    Dav1dPicture picture; /**< Last output picture, kept referenced until the next decode so its planes stay valid */
+    bool has_picture;
+    Dav1dPicture held_picture; /**< Picture held by GleedHoldDav1dPicture, its planes stay valid until it's released */
+    bool has_held_picture;
+} MovieDav1dContext;
+
+static SDL_Colorspace dav1d_matrix_to_sdl_cs(const Dav1dSequenceHeader *seq_hdr)
+{
+    const bool full_range = seq_hdr->color_range != 0;
+
+    switch (seq_hdr->mtrx)
+    {
+    case DAV1D_MC_BT709:
+        return full_range ? SDL_COLORSPACE_BT709_FULL : SDL_COLORSPACE_BT709_LIMITED;
+    case DAV1D_MC_BT470BG:
+    case DAV1D_MC_BT601:
+        return full_range ? SDL_COLORSPACE_BT601_FULL : SDL_COLORSPACE_BT601_LIMITED;
+    case DAV1D_MC_BT2020_NCL:
+    case DAV1D_MC_BT2020_CL:
+        return full_range ? SDL_COLORSPACE_BT2020_FULL : SDL_COLORSPACE_BT2020_LIMITED;
+    default:
+        return SDL_COLORSPACE_YUV_DEFAULT;
+    }
+}
+
+/* Encoded frame stays owned by the movie, so dav1d must not free it */
+static void GleedDav1dNoopFree(const Uint8 *data, void *cookie)
+{
+}
+
+static void GleedDestroyDav1dDecoder(void *decoder)
+{
+    Dav1dContext *dav1d = (Dav1dContext *)decoder;
+
+    dav1d_close(&dav1d);
+}
+
+/* In-loop filters can only be chosen when dav1d is opened, so decoders with different ones are kept apart in the pool */
+static Uint64 GleedGetDav1dPoolKey(const GleedVideoDecoderOptions *options)
+{
+    const int params[1] = {options->skip_loop_filter};
+
+    return GleedHashDecoderParams(0, params, sizeof(params));
+}
+
+static bool GleedOpenDav1dDecoder(GleedMovie *movie, MovieDav1dContext *ctx)
+{
+    ctx->pool_key = GleedGetDav1dPoolKey(&movie->video_decoder_options);
+
+    /* Starting dav1d worker threads is the expensive part, so a flushed decoder is reused when possible */
+    ctx->decoder = (Dav1dContext *)GleedAcquirePooledDecoder(GLEED_CODEC_TYPE_AV1, ctx->pool_key);
+
+    if (ctx->decoder)
+    {
+        return true;
+    }
+
+    Dav1dSettings settings;
+    dav1d_default_settings(&settings);
+
+    /*
+        0 lets dav1d pick thread count from the number of logical cores, which are used for tile and postfilter threading.
+
+        Frame threading is limited to a single frame in flight, as our API expects every encoded frame
+        to produce a picture right away - with bigger delay dav1d would return pictures several frames late.
+    */
+    settings.n_threads = 0;
+    settings.max_frame_delay = 1;
+
+    /* Deblocking, CDEF and loop restoration are a large share of AV1 decode time */
+    settings.inloop_filters = movie->video_decoder_options.skip_loop_filter ? DAV1D_INLOOPFILTER_NONE : DAV1D_INLOOPFILTER_ALL;
+
+    int open_err = dav1d_open(&ctx->decoder, &settings);
+
+    if (open_err < 0)
+    {
+        ctx->decoder = NULL;
+        return GleedSetError("Failed to initialize dav1d decoder: %d", open_err);
+    }
+
+    return true;
+}
+
+static bool GleedInitDav1d(GleedMovie *movie)
+{
+    MovieDav1dContext *ctx = (MovieDav1dContext *)SDL_calloc(1, sizeof(MovieDav1dContext));
+
+    if (!ctx)
+    {
+        return GleedSetError("Failed to allocate memory for dav1d context");
+    }
+
+    if (!GleedOpenDav1dDecoder(movie, ctx))
+    {
+        SDL_free(ctx);
+        return false;
+    }
+
+    movie->dav1d_context = ctx;
+
+    return true;
+}
+
+/*
+    Decoder is reopened when options it was opened with change, but only at a keyframe,
+    as a new decoder has no reference frames. Held pictures are reference counted, so they outlive the old one.
+*/
+static bool GleedUpdateDav1dOptions(GleedMovie *movie, MovieDav1dContext *ctx)
+{
+    /* Previous reopen failed */
+    if (!ctx->decoder)
+    {
+        return GleedOpenDav1dDecoder(movie, ctx);
+    }
+
+    if (ctx->pool_key == GleedGetDav1dPoolKey(&movie->video_decoder_options))
+    {
+        return true;
+    }
+
+    const CachedMovieFrame *frame = GleedGetCurrentCachedFrame(movie, GLEED_TRACK_TYPE_VIDEO);
+
+    if (!frame || !frame->key_frame)
+    {
+        return true;
+    }
+
+    if (ctx->has_picture)
+    {
+        dav1d_picture_unref(&ctx->picture);
+        ctx->has_picture = false;
+    }
+
+    dav1d_flush(ctx->decoder);
+
+    GleedReleasePooledDecoder(GLEED_CODEC_TYPE_AV1, ctx->pool_key, ctx->decoder, GleedDestroyDav1dDecoder);
+    ctx->decoder = NULL;
+
+    return GleedOpenDav1dDecoder(movie, ctx);
+}
+
+bool GleedDecodeDav1d(GleedMovie *movie, bool convert)
+{
+    Uint64 decode_start = SDL_GetTicks();
+
+    if (!movie->dav1d_context)
+    {
+        if (!GleedInitDav1d(movie))
+        {
+            return false;
+        }
+    }
+
+    MovieDav1dContext *ctx = (MovieDav1dContext *)movie->dav1d_context;
+
+    if (!GleedUpdateDav1dOptions(movie, ctx))
+    {
+        return false;
+    }
+
+    if (ctx->has_picture)
+    {
+        dav1d_picture_unref(&ctx->picture);
+        ctx->has_picture = false;
+    }
+
+    Dav1dData data = {0};
+
+    int err = dav1d_data_wrap(&data, movie->encoded_video_frame, movie->encoded_video_frame_size, GleedDav1dNoopFree, NULL);
+
+    if (err < 0)
+    {
+        return GleedSetError("Failed to wrap AV1 frame data: %d", err);
+    }
+
+    /* dav1d consumes data partially and asks to drain pictures first when its internal queue is full */
+    while (data.sz > 0)
+    {
+        err = dav1d_send_data(ctx->decoder, &data);
+
+        if (err == DAV1D_ERR(EAGAIN))
+        {
+            if (ctx->has_picture)
+            {
+                dav1d_picture_unref(&ctx->picture);
+                ctx->has_picture = false;
+            }
+
+            err = dav1d_get_picture(ctx->decoder, &ctx->picture);
+
+            if (err < 0 && err != DAV1D_ERR(EAGAIN))
+            {
+                dav1d_data_unref(&data);
+                return GleedSetError("Failed to get decoded AV1 picture: %d", err);
+            }
+
+            ctx->has_picture = err == 0;
+        }
+        else if (err < 0)
+        {
+            dav1d_data_unref(&data);
+            return GleedSetError("Failed to decode AV1 frame: %d", err);
+        }
+    }
+
+    /* Frames which are not shown produce no picture, decoding them was enough to update references */
+    if (!convert)
+    {
+        movie->last_frame_decode_ms = SDL_GetTicks() - decode_start;
+        return true;
+    }
+
+    if (!ctx->has_picture)
+    {
+        err = dav1d_get_picture(ctx->decoder, &ctx->picture);
+
+        if (err < 0)
+        {
+            return GleedSetError("Failed to get decoded AV1 picture - received no image: %d", err);
+        }
+
+        ctx->has_picture = true;
+    }
+
+    const Dav1dPicture *pic = &ctx->picture;
+
+    if (pic->p.bpc != 8 || pic->p.layout != DAV1D_PIXEL_LAYOUT_I420)
+    {
+        return GleedSetError("Unsupported AV1 picture format, only 8-bit 4:2:0 is supported");
+    }
+
+    DecodedVideoFrame frame;
+    frame.width = pic->p.w;
+    frame.height = pic->p.h;
+    frame.format = SDL_PIXELFORMAT_IYUV;
+    frame.colorspace = dav1d_matrix_to_sdl_cs(pic->seq_hdr);
+
+    /* dav1d shares one stride between both chroma planes */
+    frame.planes[0] = (const Uint8 *)pic->data[0];
+    frame.planes[1] = (const Uint8 *)pic->data[1];
+    frame.planes[2] = (const Uint8 *)pic->data[2];
+    frame.strides[0] = (int)pic->stride[0];
+    frame.strides[1] = (int)pic->stride[1];
+    frame.strides[2] = (int)pic->stride[1];
+
+    if (!GleedConvertDecodedFrame(movie, &frame))
+    {
+        return false;
+    }
+
+    movie->last_frame_decode_ms = SDL_GetTicks() - decode_start;
+
+    return true;
+}
+
+bool GleedHoldDav1dPicture(GleedMovie *movie)
+{
+    MovieDav1dContext *ctx = (MovieDav1dContext *)movie->dav1d_context;
+
+    if (!ctx || !ctx->has_picture)
+    {
+        return false;
+    }
+
+    GleedReleaseDav1dPicture(movie);
+
+    /* Pictures are reference counted, so an extra reference is all it takes */
+    dav1d_picture_ref(&ctx->held_picture, &ctx->picture);
+    ctx->has_held_picture = true;
+
+    return true;
+}
+
+void GleedReleaseDav1dPicture(GleedMovie *movie)
+{
+    MovieDav1dContext *ctx = (MovieDav1dContext *)movie->dav1d_context;
+
+    if (ctx && ctx->has_held_picture)
+    {
+        dav1d_picture_unref(&ctx->held_picture);
+        ctx->has_held_picture = false;
+    }
+}
+
+void GleedResetDav1d(GleedMovie *movie)
+{
+    if (movie->dav1d_context)
+    {
+        MovieDav1dContext *ctx = (MovieDav1dContext *)movie->dav1d_context;
+
+        GleedReleaseDav1dPicture(movie);
+
+        if (ctx->has_picture)
+        {
+            dav1d_picture_unref(&ctx->picture);
+            ctx->has_picture = false;
+        }
+
+        if (ctx->decoder)
+        {
+            dav1d_flush(ctx->decoder);
+        }
+    }
+}
+
+void GleedCloseDav1d(GleedMovie *movie)
+{
+    if (movie->dav1d_context)
+    {
+        MovieDav1dContext *ctx = (MovieDav1dContext *)movie->dav1d_context;
+
+        GleedReleaseDav1dPicture(movie);
+
+        if (ctx->has_picture)
+        {
+            dav1d_picture_unref(&ctx->picture);
+        }
+
+        if (ctx->decoder)
+        {
+            dav1d_flush(ctx->decoder);
+
+            GleedReleasePooledDecoder(GLEED_CODEC_TYPE_AV1, ctx->pool_key, ctx->decoder, GleedDestroyDav1dDecoder);
+        }
+
+        SDL_free(ctx);
+
+        movie->dav1d_context = NULL;
+    }
+}
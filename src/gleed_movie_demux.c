@@ -0,0 +1,267 @@
+#include "gleed_movie_internal.h"
+
+static PooledPacket *GleedAcquirePooledPacket(GleedMovie *movie, Uint32 size)
+{
+    PooledPacket *pooled = movie->free_packets;
+
+    if (pooled)
+    {
+        movie->free_packets = pooled->next;
+    }
+    else
+    {
+        pooled = (PooledPacket *)SDL_calloc(1, sizeof(PooledPacket));
+
+        if (!pooled)
+        {
+            GleedSetError("Failed to allocate memory for packet");
+            return NULL;
+        }
+    }
+
+    pooled->next = NULL;
+
+    if (pooled->capacity < size)
+    {
+        Uint8 *data = (Uint8 *)SDL_realloc(pooled->data, size);
+
+        if (!data)
+        {
+            pooled->next = movie->free_packets;
+            movie->free_packets = pooled;
+            GleedSetError("Failed to allocate memory for packet data");
+            return NULL;
+        }
+
+        pooled->data = data;
+        pooled->capacity = size;
+    }
+
+    return pooled;
+}
+
+static void GleedReturnPooledPacket(GleedMovie *movie, PooledPacket *pooled)
+{
+    pooled->next = movie->free_packets;
+    movie->free_packets = pooled;
+}
+
+static PooledPacket **GleedGetPacketQueueHead(GleedMovie *movie, GleedMovieTrackType type)
+{
+    return type == GLEED_TRACK_TYPE_VIDEO ? &movie->video_packets_head : &movie->audio_packets_head;
+}
+
+static PooledPacket **GleedGetPacketQueueTail(GleedMovie *movie, GleedMovieTrackType type)
+{
+    return type == GLEED_TRACK_TYPE_VIDEO ? &movie->video_packets_tail : &movie->audio_packets_tail;
+}
+
+bool GleedReadPacket(GleedMovie *movie, GleedMoviePacket *packet)
+{
+    if (!movie || !packet)
+    {
+        return GleedSetError("movie and packet cannot be NULL");
+    }
+
+    SDL_LockMutex(movie->io_lock);
+
+    CachedMovieFrame *video_frame = NULL;
+    CachedMovieFrame *audio_frame = NULL;
+
+    if (movie->current_video_track != GLEED_NO_TRACK && movie->demux_video_frame < movie->total_frames)
+    {
+        video_frame = &movie->cached_frames[movie->current_video_track][movie->demux_video_frame];
+    }
+
+    if (movie->current_audio_track != GLEED_NO_TRACK && movie->demux_audio_frame < movie->total_audio_frames)
+    {
+        audio_frame = &movie->cached_frames[movie->current_audio_track][movie->demux_audio_frame];
+    }
+
+    if (!video_frame && !audio_frame)
+    {
+        SDL_UnlockMutex(movie->io_lock);
+        return GleedSetError("No more packets left");
+    }
+
+    /* Whichever frame comes first in the file is read first, so the file is walked sequentially */
+    const bool take_video = video_frame && (!audio_frame || video_frame->offset <= audio_frame->offset);
+
+    CachedMovieFrame *frame = take_video ? video_frame : audio_frame;
+
+    PooledPacket *pooled = GleedAcquirePooledPacket(movie, frame->size);
+
+    if (!pooled)
+    {
+        SDL_UnlockMutex(movie->io_lock);
+        return false;
+    }
+
+    SDL_SeekIO(movie->io, frame->offset, SDL_IO_SEEK_SET);
+
+    if (SDL_ReadIO(movie->io, pooled->data, frame->size) != frame->size)
+    {
+        GleedReturnPooledPacket(movie, pooled);
+        SDL_UnlockMutex(movie->io_lock);
+        return GleedSetError("Failed to read packet data: %s", SDL_GetError());
+    }
+
+    GleedMoviePacket *result = &pooled->packet;
+
+    result->type = take_video ? GLEED_TRACK_TYPE_VIDEO : GLEED_TRACK_TYPE_AUDIO;
+    result->track = take_video ? movie->current_video_track : movie->current_audio_track;
+    result->frame = take_video ? movie->demux_video_frame : movie->demux_audio_frame;
+    result->timecode_ms = GleedTimecodeToMilliseconds(movie, frame->timecode);
+    result->key_frame = frame->key_frame;
+    result->data = pooled->data;
+    result->size = frame->size;
+    result->internal = pooled;
+
+    if (take_video)
+    {
+        movie->demux_video_frame++;
+    }
+    else
+    {
+        movie->demux_audio_frame++;
+    }
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    *packet = *result;
+
+    return true;
+}
+
+void GleedReleasePacket(GleedMovie *movie, GleedMoviePacket *packet)
+{
+    if (!movie || !packet || !packet->internal)
+        return;
+
+    SDL_LockMutex(movie->io_lock);
+    GleedReturnPooledPacket(movie, (PooledPacket *)packet->internal);
+    SDL_UnlockMutex(movie->io_lock);
+
+    SDL_zerop(packet);
+}
+
+bool GleedQueuePacket(GleedMovie *movie, GleedMoviePacket *packet)
+{
+    if (!movie || !packet || !packet->internal)
+    {
+        return GleedSetError("Packet must be obtained with GleedReadPacket");
+    }
+
+    PooledPacket *pooled = (PooledPacket *)packet->internal;
+
+    SDL_LockMutex(movie->io_lock);
+
+    pooled->next = NULL;
+
+    PooledPacket **head = GleedGetPacketQueueHead(movie, packet->type);
+    PooledPacket **tail = GleedGetPacketQueueTail(movie, packet->type);
+
+    if (*tail)
+    {
+        (*tail)->next = pooled;
+    }
+    else
+    {
+        *head = pooled;
+    }
+
+    *tail = pooled;
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    SDL_zerop(packet);
+
+    return true;
+}
+
+bool GleedTakeQueuedPacket(GleedMovie *movie, GleedMovieTrackType type, Uint32 frame, Uint8 **dest, Uint32 *dest_capacity, Uint32 *dest_size)
+{
+    bool found = false;
+
+    SDL_LockMutex(movie->io_lock);
+
+    PooledPacket **head = GleedGetPacketQueueHead(movie, type);
+    PooledPacket **tail = GleedGetPacketQueueTail(movie, type);
+
+    /* Drop packets which were skipped by decoding side (e.g. after seeking) */
+    while (*head && (*head)->packet.frame < frame)
+    {
+        PooledPacket *stale = *head;
+        *head = stale->next;
+        GleedReturnPooledPacket(movie, stale);
+    }
+
+    if (*head && (*head)->packet.frame == frame)
+    {
+        PooledPacket *pooled = *head;
+        *head = pooled->next;
+
+        /*
+            Consumer takes ownership of the pooled buffer, and its previous buffer goes to the pool instead,
+            so packet data is never copied. Pool grows buffers it gets back on demand.
+        */
+        Uint8 *data = pooled->data;
+        const Uint32 capacity = pooled->capacity;
+
+        pooled->data = *dest;
+        pooled->capacity = *dest ? *dest_capacity : 0;
+
+        *dest = data;
+        *dest_capacity = capacity;
+        *dest_size = pooled->packet.size;
+        found = true;
+
+        GleedReturnPooledPacket(movie, pooled);
+    }
+
+    if (!*head)
+    {
+        *tail = NULL;
+    }
+
+    SDL_UnlockMutex(movie->io_lock);
+
+    return found;
+}
+
+void GleedFlushPacketQueues(GleedMovie *movie)
+{
+    SDL_LockMutex(movie->io_lock);
+
+    for (int type = GLEED_TRACK_TYPE_VIDEO; type <= GLEED_TRACK_TYPE_AUDIO; type++)
+    {
+        PooledPacket **head = GleedGetPacketQueueHead(movie, (GleedMovieTrackType)type);
+
+        while (*head)
+        {
+            PooledPacket *pooled = *head;
+            *head = pooled->next;
+            GleedReturnPooledPacket(movie, pooled);
+        }
+
+        *GleedGetPacketQueueTail(movie, (GleedMovieTrackType)type) = NULL;
+    }
+
+    movie->demux_video_frame = movie->current_frame;
+    movie->demux_audio_frame = movie->current_audio_frame;
+
+    SDL_UnlockMutex(movie->io_lock);
+}
+
+void GleedFreePacketPool(GleedMovie *movie)
+{
+    GleedFlushPacketQueues(movie);
+
+    while (movie->free_packets)
+    {
+        PooledPacket *pooled = movie->free_packets;
+        movie->free_packets = pooled->next;
+        SDL_free(pooled->data);
+        SDL_free(pooled);
+    }
+}
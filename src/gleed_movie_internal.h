@@ -27,10 +27,42 @@ extern "C"
         Uint32 offset;     /**< Offset of the frame in WebM file */
         Uint32 size;       /**< Size of frame in WebM in bytes */
         bool key_frame;    /**< Is given frame a keyframe; needed for seeking and maintaining codecs state */
+        bool visible;      /**< False for frames only used as reference by following ones (e.g. VP8 alt-ref), they are decoded but never shown */
     } CachedMovieFrame;
+
+    /**
+     * Packet buffer owned by the movie packet pool.
+     *
+     * Nodes are linked either into the pool free list or into one of per-type decode queues.
+     */
+    typedef struct PooledPacket
+    {
+        GleedMoviePacket packet;   /**< Packet description handed out to the user */
+        Uint8 *data;               /**< Packet data buffer, reused between packets */
+        Uint32 capacity;           /**< Capacity of the data buffer */
+        struct PooledPacket *next; /**< Next node in free list or queue */
+    } PooledPacket;
+
+    /**
+     * This structure describes a single decoded (but not yet converted) video frame.
+     *
+     * Planes are owned by the decoder which produced them and are only valid until the next decode call.
+     * Every video decoder fills it in and passes it to GleedConvertDecodedFrame, so all codecs share one output path.
+     */
+    typedef struct
+    {
+        const Uint8 *planes[3];    /**< Y, U and V planes */
+        int strides[3];            /**< Stride of each plane in bytes */
+        int width;                 /**< Visible frame width in pixels */
+        int height;                /**< Visible frame height in pixels */
+        SDL_PixelFormat format;    /**< Planar SDL pixel format the planes follow (IYUV or YV12) */
+        SDL_Colorspace colorspace; /**< Colorspace of the decoded frame */
+    } DecodedVideoFrame;
+
     typedef struct GleedMovie
     {
         SDL_IOStream *io; /**< IO stream to read movie data */
+        bool owns_io;     /**< io was opened by GleedOpenAsync, so it's closed with the movie regardless of closeio */
 
         Uint32 ntracks;                           /**< Number of tracks in the movie */
         GleedMovieTrack tracks[MAX_GLEED_TRACKS]; /**< Array of tracks */
@@ -41,19 +73,80 @@ extern "C"
 
         Uint8 *encoded_video_frame;                /**< Current encoded video frame data */
         Uint32 encoded_video_frame_size;           /**< Size of the encoded video frame data */
+        Uint32 encoded_video_frame_capacity;       /**< Capacity of the encoded video frame buffer */
         Uint8 *conversion_video_frame_buffer;      /**< Buffer for decoded video frame data, can be used by decoder to reduce allocations */
         Uint32 conversion_video_frame_buffer_size; /**< Size of the buffer for decoded video frame data */
         void *vpx_context;                         /**< VPX decoder context (both VP8 and VP9) */
+        void *dav1d_context;                       /**< dav1d decoder context (AV1), NULL if AV1 not used */
         SDL_PixelFormat video_pixel_format;        /**< Pixel format for the video track */
         SDL_Surface *current_frame_surface;        /**< Current video frame surface, containing decoded frame pixels */
         GleedMovieCodecType video_codec;           /**< Video codec type */
 
-        Uint8 *encoded_audio_frame;      /**< Current encoded audio frame data */
-        Uint32 encoded_audio_frame_size; /**< Size of the encoded audio frame data */
+        bool dirty_rects_enabled;       /**< Convert and upload only changed regions of video frames */
+        bool dirty_blocks_fresh;        /**< Block hashes were not computed yet, so every block is dirty */
+        int dirty_blocks_w;             /**< Width of dirty detection block grid */
+        int dirty_blocks_h;             /**< Height of dirty detection block grid */
+        Uint64 *block_hashes;           /**< Hash of each block of the last decoded frame */
+        Uint8 *dirty_blocks;            /**< Blocks changed by the last decoded frame */
+        Uint8 *pending_upload_blocks;   /**< Blocks changed since the last playback texture upload */
+        SDL_Rect *dirty_rects;          /**< Dirty rectangles of the last decoded frame */
+        int dirty_rects_count;          /**< Number of dirty rectangles of the last decoded frame */
+        SDL_Rect *upload_rects;         /**< Scratch rectangles for playback texture upload */
+
+        void *target_pixels;            /**< Caller-owned conversion target set by GleedDecodeVideoFrameInto, NULL to convert into current_frame_surface */
+        int target_pitch;               /**< Pitch of the conversion target */
+        SDL_PixelFormat target_format;  /**< Pixel format of the conversion target */
+
+        bool skip_video_conversion;          /**< Do not convert decoded frames to RGB, only planes are exposed */
+        bool has_decoded_video_frame;        /**< decoded_video_frame describes the last decoded frame */
+        DecodedVideoFrame decoded_video_frame; /**< Planes of the last decoded frame, owned by the decoder */
+
+        bool video_frame_primed; /**< Current video frame was decoded ahead of time, next decode call just returns it */
+        bool audio_frame_primed; /**< Current audio frame was decoded ahead of time, next decode call just returns it */
+
+        GleedVideoDecoderOptions video_decoder_options; /**< Decoder speed and quality settings */
+
+        bool drop_video_conversion;                     /**< Next decoded frame is never shown, so it's not converted */
+
+        bool pipelined_decoding;                 /**< Decode the next frame while the current one is converted */
+        bool defer_video_conversion;             /**< Decoders only store decoded frames into pipelined_video_frame, without conversion */
+        bool has_pipelined_video_frame;          /**< pipelined_video_frame describes a frame decoded ahead */
+        DecodedVideoFrame pipelined_video_frame; /**< Planes of the frame decoded ahead, not converted yet */
+        Uint32 pipeline_start_frame;             /**< Frame the decode ahead started at, it's only used if playback continues from there */
+        Uint32 pipeline_frame;                   /**< Visible frame decoded ahead (following invisible frames are decoded before it) */
+        bool has_pipeline_error;                 /**< Decoding ahead failed at pipeline_frame, after its packets were sent to the decoder */
+        char pipeline_error[1024];               /**< Error of the failed decode ahead, reported by the next decode call */
+        Uint8 *held_video_frame_buffer;          /**< Copy of decoded planes for decoders unable to keep them alive on their own */
+        size_t held_video_frame_buffer_size;     /**< Size of the held frame copy buffer */
+
+        Uint8 *encoded_audio_frame;                /**< Current encoded audio frame data, points either to read buffer or inside preload buffer */
+        Uint32 encoded_audio_frame_size;           /**< Size of the encoded audio frame data */
+        Uint8 *audio_frame_read_buffer;            /**< Buffer for audio frames read from IO */
+        Uint32 audio_frame_read_buffer_capacity;   /**< Capacity of the audio frame read buffer */
 
         Uint8 *encoded_audio_buffer;      /**< Encoded audio buffer, containing ALL audio at once (for preload) */
         Uint32 encoded_audio_buffer_size; /**< Encoded audio buffer size */
 
+        Uint64 video_window_ms;               /**< Duration of video ahead of the current frame kept in memory, 0 if video is not preloaded */
+        Uint8 *video_window_buffer;           /**< File bytes of the preloaded window, read in one go */
+        Uint32 video_window_capacity;         /**< Capacity of the window buffer */
+        Uint64 video_window_offset;           /**< File offset of the first byte in the window buffer */
+        Uint32 video_window_size;             /**< Number of valid bytes in the window buffer */
+        Uint32 video_window_first_frame;      /**< Index of the first video frame the window was read for */
+        Uint32 video_window_end_frame;        /**< Index of the first video frame past the window */
+
+        /* Next window is read in background with SDL async I/O, only possible for movies opened from a file path */
+        char *file_path;                      /**< Path the movie was opened from, NULL if it was opened from a stream */
+        SDL_AsyncIO *window_async_file;       /**< Second handle of the file used for background window reads */
+        SDL_AsyncIOQueue *window_async_queue; /**< Queue receiving results of background window reads */
+        bool window_async_unavailable;        /**< File could not be opened for async I/O, windows are only read synchronously */
+        bool video_prefetch_pending;          /**< Background read of the next window was started and its result not collected yet */
+        Uint8 *video_prefetch_buffer;         /**< Buffer the next window is read into, swapped with the window buffer once done */
+        Uint32 video_prefetch_capacity;       /**< Capacity of the prefetch buffer */
+        Uint64 video_prefetch_offset;         /**< File offset of the next window */
+        Uint32 video_prefetch_first_frame;    /**< Index of the first video frame of the next window */
+        Uint32 video_prefetch_end_frame;      /**< Index of the first video frame past the next window */
+
         GleedMovieAudioSample *decoded_audio_frame; /**< Decoded audio frame data */
         int decoded_audio_samples;                  /**< Number of decoded audio samples combined for all channels */
         Uint32 decoded_audio_frame_size;            /**< Size of the decoded audio frame
@@ -62,6 +155,7 @@ extern "C"
         void *vorbis_context;                       /**< Vorbis decoder context, NULL if vorbis not used */
         void *opus_context;                         /**< Opus decoder context, NULL if opus not used */
         SDL_AudioSpec audio_spec;                   /**< Audio spec for the audio track */
+        int opus_decode_frequency;                  /**< Frequency Opus is decoded at, 0 to use the track frequency */
         GleedMovieCodecType audio_codec;            /**< Audio codec type */
 
         Uint64 timecode_scale; /**< Timecode scale from WebM file */
@@ -76,14 +170,61 @@ extern "C"
 
         Sint32 current_video_track; /**< Current video track index or GLEED_NO_TRACK if not set */
         Sint32 current_audio_track; /**< Current audio track index or GLEED_NO_TRACK if not set  */
+
+        SDL_Mutex *io_lock;                /**< Guards io and packet queues, as demuxing may run on another thread than decoding */
+        Uint32 demux_video_frame;          /**< Next video frame to be read by GleedReadPacket */
+        Uint32 demux_audio_frame;          /**< Next audio frame to be read by GleedReadPacket */
+        PooledPacket *free_packets;        /**< Pool of packet buffers available for reuse */
+        PooledPacket *video_packets_head;  /**< Queue of demuxed video packets waiting for decode */
+        PooledPacket *video_packets_tail;  /**< Last queued video packet */
+        PooledPacket *audio_packets_head;  /**< Queue of demuxed audio packets waiting for decode */
+        PooledPacket *audio_packets_tail;  /**< Last queued audio packet */
     } GleedMovie;
 
     extern bool GleedParseWebM(GleedMovie *movie);
 
-    extern bool GleedDecodeVPX(GleedMovie *movie);
+    /* If convert is false, frame is only decoded to update decoder references (invisible frames) */
+    extern bool GleedDecodeVPX(GleedMovie *movie, bool convert);
 
     extern void GleedCloseVPX(GleedMovie *movie);
 
+    /*
+        Keeps planes of the last decoded frame valid through following decode calls, until released.
+        Returns false if the decoder can't do it (VP8), planes must be copied then.
+    */
+    extern bool GleedHoldVPXFrame(GleedMovie *movie);
+
+    extern void GleedReleaseVPXFrame(GleedMovie *movie);
+
+    extern bool GleedDecodeDav1d(GleedMovie *movie, bool convert);
+
+    extern void GleedCloseDav1d(GleedMovie *movie);
+
+    extern void GleedResetDav1d(GleedMovie *movie);
+
+    /* Same as GleedHoldVPXFrame, for the last picture returned by dav1d */
+    extern bool GleedHoldDav1dPicture(GleedMovie *movie);
+
+    extern void GleedReleaseDav1dPicture(GleedMovie *movie);
+
+    /* Stores the frame as the last decoded one and converts it, or only stores it for pipelined conversion */
+    extern bool GleedConvertDecodedFrame(GleedMovie *movie, const DecodedVideoFrame *frame);
+
+    /* Converts the frame into the frame surface or the caller-owned target */
+    extern bool GleedConvertVideoFrame(GleedMovie *movie, const DecodedVideoFrame *frame);
+
+    extern void GleedResetDirtyBlocks(GleedMovie *movie);
+
+    /* Drops the preloaded video window and waits for its background read, io_lock must be held */
+    extern void GleedDiscardVideoWindow(GleedMovie *movie);
+
+    /* Same as GleedDiscardVideoWindow, and also closes the file handle used for background reads */
+    extern void GleedCloseVideoWindow(GleedMovie *movie);
+
+    extern int GleedCollectDirtyRects(GleedMovie *movie, const Uint8 *blocks, SDL_Rect *rects);
+
+    extern bool GleedUploadPlaybackTexture(GleedMovie *movie, SDL_Texture *texture, bool full_upload);
+
     typedef enum
     {
         GLEED_VORBIS_DECODE_DONE = 0,
@@ -96,16 +237,26 @@ extern "C"
 
     extern void GleedCloseVorbis(GleedMovie *movie);
 
+    /* Drops decoder state, so it can start decoding another stream with the same parameters */
+    extern void GleedResetVorbis(GleedMovie *movie);
+
     extern bool GleedDecodeOpus(GleedMovie *movie);
 
     extern void GleedCloseOpus(GleedMovie *movie);
 
+    extern void GleedResetOpus(GleedMovie *movie);
+
+    /* Is frequency one libopus can decode at natively */
+    extern bool GleedIsOpusDecodeFrequency(int frequency);
+
     extern bool GleedSetError(const char *fmt, ...);
 
-    extern void GleedAddCachedFrame(GleedMovie *movie, Uint32 track, Uint64 timecode, Uint32 offset, Uint32 size, bool key_frame);
+    extern void GleedAddCachedFrame(GleedMovie *movie, Uint32 track, Uint64 timecode, Uint32 offset, Uint32 size, bool key_frame, bool visible);
 
     extern int GleedFindTrackByNumber(GleedMovie *movie, Uint32 track_number);
 
+    extern GleedMovieCodecType GleedGetTrackCodec(GleedMovieTrack *track);
+
     extern bool GleedCanPlaybackVideo(GleedMovie *movie);
 
     extern bool GleedCanPlaybackAudio(GleedMovie *movie);
@@ -118,6 +269,64 @@ extern "C"
 
     extern void GleedReadCurrentFrame(GleedMovie *movie, GleedMovieTrackType type);
 
+    /* Takes the queued packet of the given frame, if any, by exchanging its pooled buffer with *dest */
+    extern bool GleedTakeQueuedPacket(GleedMovie *movie, GleedMovieTrackType type, Uint32 frame, Uint8 **dest, Uint32 *dest_capacity, Uint32 *dest_size);
+
+    extern void GleedFlushPacketQueues(GleedMovie *movie);
+
+    extern void GleedFreePacketPool(GleedMovie *movie);
+
+/* Maximum number of idle decoders kept by the process-wide decoder pool */
+#define GLEED_DECODER_POOL_SIZE 8
+
+    /* Destroys a decoder context which the pool has no room for */
+    typedef void (*GleedDestroyDecoderFunc)(void *decoder);
+
+    /*
+        Takes an idle decoder context created for the same codec and key (e.g. a hash of parameters it was created with)
+        out of the pool. Returns NULL if there is none, the caller creates a new one then.
+    */
+    extern void *GleedAcquirePooledDecoder(GleedMovieCodecType codec, Uint64 key);
+
+    /* Checks an idle decoder context with a matching key, for keys which don't fully describe its parameters */
+    typedef bool (*GleedMatchDecoderFunc)(const void *decoder, const void *userdata);
+
+    /* Same as GleedAcquirePooledDecoder, but contexts must also pass the match function, which is called with the pool locked */
+    extern void *GleedAcquireMatchingPooledDecoder(GleedMovieCodecType codec, Uint64 key, GleedMatchDecoderFunc match, const void *userdata);
+
+    /*
+        Gives a decoder context, which is no longer used by a movie, to the pool. Context must be already reset,
+        so it can decode another stream right away. If the pool is full, the oldest idle context is destroyed.
+    */
+    extern void GleedReleasePooledDecoder(GleedMovieCodecType codec, Uint64 key, void *decoder, GleedDestroyDecoderFunc destroy);
+
+    extern Uint64 GleedHashDecoderParams(Uint64 hash, const void *data, size_t size);
+
+/* Maximum number of threads in the process-wide worker pool, besides the calling thread */
+#define GLEED_MAX_WORKER_THREADS 7
+
+    /* Runs a single job of a batch, index is in 0..count-1 range */
+    typedef void (*GleedParallelJobFunc)(void *userdata, int index);
+
+    /*
+        Runs count jobs on the worker pool and the calling thread, and returns once all of them are done.
+        May be called from jobs of another batch, then idle workers share jobs of both.
+        Jobs run serially on the calling thread if the pool has no threads or is being resized.
+    */
+    extern void GleedRunParallel(GleedParallelJobFunc func, void *userdata, int count);
+
+    /* Number of threads GleedRunParallel spreads jobs across, including the calling thread */
+    extern int GleedGetParallelism(void);
+
+/* Number of bytes at the start of a video frame enough for GleedDetectKeyFrame */
+#define GLEED_KEYFRAME_PEEK_SIZE 64
+
+    /*
+        Detects whether encoded frame data is a keyframe by looking at its bitstream header.
+        Returns false if it could not be determined (unknown codec or malformed data), key_frame is not modified then.
+    */
+    extern bool GleedDetectKeyFrame(GleedMovieCodecType codec, const Uint8 *data, Uint32 size, bool *key_frame);
+
     extern CachedMovieFrame *GleedGetCurrentCachedFrame(GleedMovie *movie, GleedMovieTrackType type);
 
     extern Uint64 GleedTimecodeToMilliseconds(GleedMovie *movie, Uint64 timecode);
@@ -126,13 +335,19 @@ extern "C"
 
     extern Uint64 GleedMillisecondsToTimecode(GleedMovie *movie, Uint64 ms);
 
+    /*
+        Decodes the current video and audio frames ahead of time, so the following decode calls return them
+        without any work. Used to prepare a movie on a worker thread before it starts playing.
+    */
+    extern bool GleedPrimeMovie(GleedMovie *movie);
+
     typedef struct GleedMoviePlayer
     {
-        bool paused;         /**< Is player paused */
-        bool finished;       /**< Has player finished playback (no more frames left) */
-        bool video_playback; /**< Is video playback enabled */
-        bool audio_playback; /**< Is audio playback enabled */
-        GleedMovie *mov;     /**< Movie instance */
+        SDL_AtomicInt paused; /**< Is player paused, also read by the audio mixer callback */
+        bool finished;        /**< Has player finished playback (no more frames left) */
+        bool video_playback;  /**< Is video playback enabled */
+        bool audio_playback;  /**< Is audio playback enabled */
+        GleedMovie *mov;      /**< Movie instance */
 
         Uint64 last_frame_at_ticks; /**< Last frame time in ticks, used for synchronization */
 
@@ -144,12 +359,41 @@ extern "C"
         Uint32 audio_buffer_capacity;         /**< Capacity of the audio buffer */
         SDL_AudioDeviceID bound_audio_device; /**< Audio device bound to the audio stream, or 0 if none */
         SDL_AudioStream *output_audio_stream; /**< Audio stream for output, may be NULL */
+        GleedAudioMixer *audio_mixer;         /**< Mixer draining the output stream instead of a device, may be NULL */
         int audio_output_samples_buffer_size; /**< Size of the audio output buffer in samples (hardware-specific) */
         int audio_output_samples_buffer_ms;   /**< Audio output frame size in ms (hardware-specific) */
+        int audio_output_frequency;           /**< Frequency of the audio output, 0 if none is set */
+        bool audio_started;                   /**< Audio of the current movie was decoded since it started */
 
         Uint64 next_video_frame_at;               /**< Time in milliseconds when next video frame should be played (in movie time) */
         SDL_Surface *current_video_frame_surface; /**< Current video frame surface */
-        SDL_Texture *output_video_frame_texture;  /**< Output video frame texture, may be NULL */
+        SDL_Texture *output_video_frame_textures[GLEED_PLAYER_MAX_OUTPUT_TEXTURES]; /**< Output video frame textures, rotated on each update */
+        int output_video_frame_textures_count;                                      /**< Number of output textures, 0 if none set */
+        int ready_video_frame_texture;                                              /**< Index of the texture holding the latest frame */
+        bool output_texture_uploaded;                                               /**< A frame was uploaded into the output textures since they were set */
+        bool atlas_frame_pending;                                                   /**< New video frame was not yet uploaded to the video atlas */
+
+        bool owns_movie;       /**< Movie was opened by the player from the playlist and is freed by it */
+        Uint64 movie_end_time; /**< Time in milliseconds when the current movie ends (in movie time) */
+
+        char **playlist;        /**< Paths of movies played after the current one */
+        int playlist_count;     /**< Number of movies in the playlist */
+        int playlist_capacity;  /**< Capacity of the playlist array */
+        int playlist_next;      /**< Index of the next playlist movie to preload */
+        bool playlist_loop;     /**< Start the playlist over after its last movie */
+
+        SDL_Thread *preload_thread;  /**< Worker opening and priming the next movie, NULL if none is pending */
+        const char *preload_file;    /**< Path of the movie being preloaded */
+        int preload_opus_frequency;  /**< Opus decode frequency of the current movie, carried over to the preloaded one */
+        GleedMovie *preloaded_movie; /**< Preloaded movie, valid once the worker has finished */
+        char preload_error[1024];    /**< Error message of the worker thread, valid if preloaded_movie is NULL */
+
+        bool adaptive_quality;                         /**< Lower decoding quality automatically when frames run late */
+        int quality_level;                             /**< Current quality reduction level, 0 for full quality */
+        double frame_cost_ms;                          /**< Moving average of wall time spent decoding a frame */
+        double frame_interval_ms;                      /**< Moving average of time between video frames */
+        Uint64 quality_level_changed_at;               /**< Time of the last quality level change in milliseconds (in movie time) */
+        GleedVideoDecoderOptions quality_base_options; /**< Decoder options of the current movie at full quality */
     } GleedMoviePlayer;
 
     extern void GleedAddAudioSamplesToPlayer(
@@ -157,8 +401,12 @@ extern "C"
         const GleedMovieAudioSample *samples,
         int count);
 
-    /* Not currently ready to be exposed as public API, as switching movies can be tricky*/
-    extern void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov);
+    /*
+        Decodes Opus of the player movie at the output frequency, if it's supported. Switching the decoder drops its state,
+        so it only happens before audio of the movie starts, otherwise the output stream just keeps resampling.
+    */
+    extern void GleedMatchPlayerOpusFrequency(GleedMoviePlayer *player, int frequency);
+
 
 #ifdef __cplusplus
 }
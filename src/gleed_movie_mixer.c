@@ -0,0 +1,364 @@
+#include "gleed_movie_internal.h"
+
+/* Adds count samples of src multiplied by gain to dst */
+typedef void (*GleedMixSamplesFunc)(float *dst, const float *src, int count, float gain);
+
+typedef struct
+{
+    GleedMoviePlayer *player; /**< Player feeding this input */
+    SDL_AudioStream *stream;  /**< Player output stream, converts movie audio to the mixer format, not bound to any device */
+    float gain;               /**< Gain applied to player samples */
+} GleedAudioMixerInput;
+
+struct GleedAudioMixer
+{
+    SDL_AudioDeviceID device; /**< Device the mixed stream is bound to */
+    SDL_AudioSpec spec;       /**< Format of mixed samples (float, device channels and frequency) */
+    int device_sample_frames; /**< Device buffer size in sample frames */
+    SDL_AudioStream *stream;  /**< The only stream bound to the device, filled by the mixing callback */
+
+    SDL_Mutex *lock;              /**< Guards inputs, mixing callback runs on the audio device thread */
+    GleedAudioMixerInput *inputs; /**< Mixed players */
+    int inputs_count;             /**< Number of mixed players */
+    int inputs_capacity;          /**< Capacity of inputs array (vector-like allocation) */
+
+    float *mix_buffer;               /**< Accumulated samples of all inputs */
+    float *input_buffer;             /**< Samples of a single input before mixing */
+    int buffers_capacity;            /**< Capacity of both buffers in samples */
+    GleedMixSamplesFunc mix_samples; /**< Fastest mixing kernel supported by the CPU */
+};
+
+static void GleedMixSamplesScalar(float *dst, const float *src, int count, float gain)
+{
+    for (int i = 0; i < count; i++)
+    {
+        dst[i] += src[i] * gain;
+    }
+}
+
+#ifdef SDL_SSE_INTRINSICS
+static void SDL_TARGETING("sse") GleedMixSamplesSSE(float *dst, const float *src, int count, float gain)
+{
+    const __m128 vgain = _mm_set1_ps(gain);
+
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), vgain)));
+    }
+
+    GleedMixSamplesScalar(dst + i, src + i, count - i, gain);
+}
+#endif
+
+#ifdef SDL_NEON_INTRINSICS
+static void GleedMixSamplesNEON(float *dst, const float *src, int count, float gain)
+{
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+    }
+
+    GleedMixSamplesScalar(dst + i, src + i, count - i, gain);
+}
+#endif
+
+static GleedMixSamplesFunc GleedSelectMixSamples(void)
+{
+#ifdef SDL_SSE_INTRINSICS
+    if (SDL_HasSSE())
+    {
+        return GleedMixSamplesSSE;
+    }
+#endif
+
+#ifdef SDL_NEON_INTRINSICS
+    if (SDL_HasNEON())
+    {
+        return GleedMixSamplesNEON;
+    }
+#endif
+
+    return GleedMixSamplesScalar;
+}
+
+static bool GleedEnsureMixerBuffers(GleedAudioMixer *mixer, int samples)
+{
+    if (samples <= mixer->buffers_capacity)
+    {
+        return true;
+    }
+
+    float *mix_buffer = (float *)SDL_realloc(mixer->mix_buffer, samples * sizeof(float));
+
+    if (!mix_buffer)
+    {
+        return false;
+    }
+
+    mixer->mix_buffer = mix_buffer;
+
+    float *input_buffer = (float *)SDL_realloc(mixer->input_buffer, samples * sizeof(float));
+
+    if (!input_buffer)
+    {
+        return false;
+    }
+
+    mixer->input_buffer = input_buffer;
+    mixer->buffers_capacity = samples;
+
+    return true;
+}
+
+/* Called by SDL on the audio device thread whenever the device needs more samples */
+static void SDLCALL GleedMixAudio(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount)
+{
+    GleedAudioMixer *mixer = (GleedAudioMixer *)userdata;
+
+    const int samples = additional_amount / (int)sizeof(float);
+
+    if (samples <= 0)
+    {
+        return;
+    }
+
+    SDL_LockMutex(mixer->lock);
+
+    if (!GleedEnsureMixerBuffers(mixer, samples))
+    {
+        /* Nothing to recover here, device just plays silence until memory is available */
+        SDL_UnlockMutex(mixer->lock);
+        return;
+    }
+
+    SDL_memset(mixer->mix_buffer, 0, samples * sizeof(float));
+
+    for (int i = 0; i < mixer->inputs_count; i++)
+    {
+        GleedAudioMixerInput *input = &mixer->inputs[i];
+
+        /* Paused players keep their queued samples until they are resumed */
+        if (SDL_GetAtomicInt(&input->player->paused))
+        {
+            continue;
+        }
+
+        const int received = SDL_GetAudioStreamData(input->stream, mixer->input_buffer, samples * sizeof(float));
+
+        if (received > 0)
+        {
+            mixer->mix_samples(mixer->mix_buffer, mixer->input_buffer, received / (int)sizeof(float), input->gain);
+        }
+    }
+
+    SDL_PutAudioStreamData(stream, mixer->mix_buffer, samples * sizeof(float));
+
+    SDL_UnlockMutex(mixer->lock);
+}
+
+GleedAudioMixer *GleedCreateAudioMixer(SDL_AudioDeviceID dev)
+{
+    if (!dev || dev == SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK)
+    {
+        GleedSetError("Audio output device must be already opened");
+        return NULL;
+    }
+
+    GleedAudioMixer *mixer = (GleedAudioMixer *)SDL_calloc(1, sizeof(GleedAudioMixer));
+
+    if (!mixer)
+    {
+        GleedSetError("Failed to allocate memory for audio mixer");
+        return NULL;
+    }
+
+    SDL_AudioSpec device_spec;
+
+    if (!SDL_GetAudioDeviceFormat(dev, &device_spec, &mixer->device_sample_frames))
+    {
+        GleedSetError("Failed to get audio device format: %s", SDL_GetError());
+        SDL_free(mixer);
+        return NULL;
+    }
+
+    /* Same default as for players with their own output */
+    if (!mixer->device_sample_frames)
+    {
+        mixer->device_sample_frames = 1024;
+    }
+
+    mixer->device = dev;
+    mixer->mix_samples = GleedSelectMixSamples();
+
+    mixer->spec.format = SDL_AUDIO_F32;
+    mixer->spec.channels = device_spec.channels;
+    mixer->spec.freq = device_spec.freq;
+
+    mixer->lock = SDL_CreateMutex();
+
+    if (!mixer->lock)
+    {
+        GleedSetError("Failed to create audio mixer mutex: %s", SDL_GetError());
+        SDL_free(mixer);
+        return NULL;
+    }
+
+    mixer->stream = SDL_CreateAudioStream(&mixer->spec, &device_spec);
+
+    if (!mixer->stream)
+    {
+        GleedSetError("Failed to create audio stream: %s", SDL_GetError());
+        SDL_DestroyMutex(mixer->lock);
+        SDL_free(mixer);
+        return NULL;
+    }
+
+    if (!SDL_SetAudioStreamGetCallback(mixer->stream, GleedMixAudio, mixer) ||
+        !SDL_BindAudioStream(dev, mixer->stream))
+    {
+        GleedSetError("Failed to bind audio stream: %s", SDL_GetError());
+        SDL_DestroyAudioStream(mixer->stream);
+        SDL_DestroyMutex(mixer->lock);
+        SDL_free(mixer);
+        return NULL;
+    }
+
+    return mixer;
+}
+
+bool GleedAddPlayerToMixer(GleedAudioMixer *mixer, GleedMoviePlayer *player, float gain)
+{
+    if (!mixer || !player || !player->mov)
+    {
+        return GleedSetError("Mixer and player cannot be NULL");
+    }
+
+    if (!GleedCanPlaybackAudio(player->mov))
+    {
+        return GleedSetError("No audio track selected");
+    }
+
+    /* Player gives up its own device output (or another mixer) */
+    if (player->output_audio_stream && !GleedSetPlayerAudioOutput(player, 0))
+    {
+        return false;
+    }
+
+    SDL_LockMutex(mixer->lock);
+
+    if (mixer->inputs_count == mixer->inputs_capacity)
+    {
+        const int capacity = mixer->inputs_capacity ? mixer->inputs_capacity * 2 : 8;
+        GleedAudioMixerInput *inputs = (GleedAudioMixerInput *)SDL_realloc(mixer->inputs, capacity * sizeof(GleedAudioMixerInput));
+
+        if (!inputs)
+        {
+            SDL_UnlockMutex(mixer->lock);
+            return GleedSetError("Failed to allocate memory for audio mixer inputs");
+        }
+
+        mixer->inputs = inputs;
+        mixer->inputs_capacity = capacity;
+    }
+
+    player->audio_output_frequency = mixer->spec.freq;
+
+    GleedMatchPlayerOpusFrequency(player, mixer->spec.freq);
+
+    SDL_AudioStream *stream = SDL_CreateAudioStream(&player->mov->audio_spec, &mixer->spec);
+
+    if (!stream)
+    {
+        SDL_UnlockMutex(mixer->lock);
+        return GleedSetError("Failed to create audio stream: %s", SDL_GetError());
+    }
+
+    GleedAudioMixerInput *input = &mixer->inputs[mixer->inputs_count++];
+    input->player = player;
+    input->stream = stream;
+    input->gain = gain;
+
+    /* Player queues decoded samples into its output stream as usual, the mixer drains it */
+    player->output_audio_stream = stream;
+    player->bound_audio_device = 0;
+    player->audio_mixer = mixer;
+    player->audio_output_samples_buffer_size = mixer->device_sample_frames;
+    player->audio_output_samples_buffer_ms = ((Sint64)mixer->device_sample_frames * 1000) / mixer->spec.freq;
+
+    SDL_UnlockMutex(mixer->lock);
+
+    return true;
+}
+
+void GleedSetMixerPlayerGain(GleedAudioMixer *mixer, GleedMoviePlayer *player, float gain)
+{
+    if (!mixer || !player)
+        return;
+
+    SDL_LockMutex(mixer->lock);
+
+    for (int i = 0; i < mixer->inputs_count; i++)
+    {
+        if (mixer->inputs[i].player == player)
+        {
+            mixer->inputs[i].gain = gain;
+            break;
+        }
+    }
+
+    SDL_UnlockMutex(mixer->lock);
+}
+
+void GleedRemovePlayerFromMixer(GleedAudioMixer *mixer, GleedMoviePlayer *player)
+{
+    if (!mixer || !player)
+        return;
+
+    SDL_LockMutex(mixer->lock);
+
+    for (int i = 0; i < mixer->inputs_count; i++)
+    {
+        if (mixer->inputs[i].player == player)
+        {
+            SDL_DestroyAudioStream(mixer->inputs[i].stream);
+
+            mixer->inputs[i] = mixer->inputs[mixer->inputs_count - 1];
+            mixer->inputs_count--;
+
+            player->output_audio_stream = NULL;
+            player->audio_mixer = NULL;
+            player->audio_output_frequency = 0;
+            break;
+        }
+    }
+
+    SDL_UnlockMutex(mixer->lock);
+}
+
+void GleedFreeAudioMixer(GleedAudioMixer *mixer)
+{
+    if (!mixer)
+        return;
+
+    /* Destroying the bound stream also waits for the running callback */
+    SDL_DestroyAudioStream(mixer->stream);
+
+    for (int i = 0; i < mixer->inputs_count; i++)
+    {
+        SDL_DestroyAudioStream(mixer->inputs[i].stream);
+
+        mixer->inputs[i].player->output_audio_stream = NULL;
+        mixer->inputs[i].player->audio_mixer = NULL;
+        mixer->inputs[i].player->audio_output_frequency = 0;
+    }
+
+    SDL_DestroyMutex(mixer->lock);
+    SDL_free(mixer->inputs);
+    SDL_free(mixer->mix_buffer);
+    SDL_free(mixer->input_buffer);
+    SDL_free(mixer);
+}
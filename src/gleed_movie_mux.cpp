@@ -0,0 +1,396 @@
+#include "gleed_movie_internal.h"
+
+#include <mkvmuxer/mkvmuxer.h>
+#include <mkvparser/mkvparser.h>
+
+#include <vector>
+
+class SDLMkvWriter : public mkvmuxer::IMkvWriter
+{
+public:
+    SDLMkvWriter(SDL_IOStream *io) : m_io(io)
+    {
+    }
+
+    mkvmuxer::int32 Write(const void *buf, mkvmuxer::uint32 len) override
+    {
+        return SDL_WriteIO(m_io, buf, len) == len ? 0 : -1;
+    }
+
+    mkvmuxer::int64 Position() const override
+    {
+        return SDL_TellIO(m_io);
+    }
+
+    mkvmuxer::int32 Position(mkvmuxer::int64 position) override
+    {
+        return SDL_SeekIO(m_io, position, SDL_IO_SEEK_SET) < 0 ? -1 : 0;
+    }
+
+    bool Seekable() const override
+    {
+        return true;
+    }
+
+    void ElementStartNotify(mkvmuxer::uint64 element_id, mkvmuxer::int64 position) override
+    {
+    }
+
+private:
+    SDL_IOStream *m_io;
+};
+
+class SDLMkvReader : public mkvparser::IMkvReader
+{
+public:
+    SDLMkvReader(SDL_IOStream *io) : m_io(io)
+    {
+    }
+
+    int Read(long long pos, long len, unsigned char *buf) override
+    {
+        if (SDL_SeekIO(m_io, pos, SDL_IO_SEEK_SET) < 0)
+        {
+            return -1;
+        }
+
+        return SDL_ReadIO(m_io, buf, len) == (size_t)len ? 0 : -1;
+    }
+
+    int Length(long long *total, long long *available) override
+    {
+        const Sint64 size = SDL_GetIOSize(m_io);
+
+        if (size < 0)
+        {
+            return -1;
+        }
+
+        if (total)
+        {
+            *total = size;
+        }
+
+        if (available)
+        {
+            *available = size;
+        }
+
+        return 0;
+    }
+
+private:
+    SDL_IOStream *m_io;
+};
+
+/*
+    Copies encoded frames of the selected tracks of a movie into a new WebM segment, without decoding them.
+*/
+class GleedMovieMuxer
+{
+public:
+    GleedMovieMuxer(GleedMovie *movie, mkvmuxer::IMkvWriter *writer) : m_movie(movie), m_writer(writer)
+    {
+    }
+
+    bool Begin()
+    {
+        if (!m_segment.Init(m_writer))
+        {
+            return GleedSetError("Failed to initialize WebM muxer");
+        }
+
+        m_segment.set_mode(mkvmuxer::Segment::kFile);
+        m_segment.OutputCues(true);
+
+        mkvmuxer::SegmentInfo *info = m_segment.GetSegmentInfo();
+        info->set_timecode_scale(m_movie->timecode_scale);
+        info->set_writing_app("Gleed");
+
+        if (m_movie->current_video_track != GLEED_NO_TRACK && !AddTrack(m_movie->current_video_track, &m_videoTrackNumber))
+        {
+            return false;
+        }
+
+        if (m_movie->current_audio_track != GLEED_NO_TRACK && !AddTrack(m_movie->current_audio_track, &m_audioTrackNumber))
+        {
+            return false;
+        }
+
+        /* Seeking is done by video keyframes, so they are the ones to be indexed */
+        if (m_videoTrackNumber && !m_segment.CuesTrack(m_videoTrackNumber))
+        {
+            return GleedSetError("Failed to set WebM cues track");
+        }
+
+        return true;
+    }
+
+    /*
+        Copies frames with timecodes from start (inclusive) up to end (exclusive), in Matroska ticks.
+        Written timecodes are shifted so that the first written frame starts at zero.
+    */
+    bool CopyFrames(Uint64 start, Uint64 end)
+    {
+        Uint32 video_frame = FirstFrameAt(m_movie->current_video_track, start);
+        Uint32 audio_frame = FirstFrameAt(m_movie->current_audio_track, start);
+
+        /* Both tracks are sorted by timecode, so merging them keeps the muxer input in order */
+        for (;;)
+        {
+            const CachedMovieFrame *video = FrameBefore(m_movie->current_video_track, video_frame, end);
+            const CachedMovieFrame *audio = FrameBefore(m_movie->current_audio_track, audio_frame, end);
+
+            if (!video && !audio)
+            {
+                break;
+            }
+
+            const bool take_video = video && (!audio || OriginalTimecode(m_movie->current_video_track, video) <= OriginalTimecode(m_movie->current_audio_track, audio));
+
+            const int track = take_video ? m_movie->current_video_track : m_movie->current_audio_track;
+            const CachedMovieFrame *frame = take_video ? video : audio;
+
+            if (!WriteFrame(track, frame, start))
+            {
+                return false;
+            }
+
+            if (take_video)
+            {
+                video_frame++;
+            }
+            else
+            {
+                audio_frame++;
+            }
+        }
+
+        return true;
+    }
+
+    bool Finish()
+    {
+        if (!m_segment.Finalize())
+        {
+            return GleedSetError("Failed to finalize WebM segment");
+        }
+
+        return true;
+    }
+
+    /*
+        Rewrites the finished segment from the reader into the writer with Cues placed before Clusters,
+        so a player can find all seek points without scanning the whole file.
+    */
+    bool MoveCuesToFront(mkvparser::IMkvReader *reader, mkvmuxer::IMkvWriter *writer)
+    {
+        if (!m_segment.CopyAndMoveCuesBeforeClusters(reader, writer))
+        {
+            return GleedSetError("Failed to move WebM cues before clusters");
+        }
+
+        return true;
+    }
+
+private:
+    bool AddTrack(int track_index, mkvmuxer::uint64 *track_number)
+    {
+        const GleedMovieTrack *source = &m_movie->tracks[track_index];
+
+        if (source->type == GLEED_TRACK_TYPE_VIDEO)
+        {
+            *track_number = m_segment.AddVideoTrack(source->video_width, source->video_height, 0);
+        }
+        else
+        {
+            *track_number = m_segment.AddAudioTrack((int)source->audio_sample_frequency, source->audio_channels, 0);
+        }
+
+        mkvmuxer::Track *track = *track_number ? m_segment.GetTrackByNumber(*track_number) : NULL;
+
+        if (!track)
+        {
+            return GleedSetError("Failed to add track %d to WebM muxer", track_index);
+        }
+
+        track->set_codec_id(source->codec_id);
+        track->set_name(source->name);
+        track->set_language(source->language);
+
+        if (source->codec_private_data && !track->SetCodecPrivate(source->codec_private_data, source->codec_private_size))
+        {
+            return GleedSetError("Failed to set codec private data of track %d", track_index);
+        }
+
+        if (source->codec_delay > 0)
+        {
+            track->set_codec_delay(source->codec_delay);
+        }
+
+        if (source->seek_pre_roll > 0)
+        {
+            track->set_seek_pre_roll(source->seek_pre_roll);
+        }
+
+        if (source->type == GLEED_TRACK_TYPE_VIDEO && source->video_frame_rate > 0)
+        {
+            static_cast<mkvmuxer::VideoTrack *>(track)->set_frame_rate(source->video_frame_rate);
+        }
+        else if (source->type == GLEED_TRACK_TYPE_AUDIO && source->audio_bit_depth > 0)
+        {
+            static_cast<mkvmuxer::AudioTrack *>(track)->set_bit_depth(source->audio_bit_depth);
+        }
+
+        return true;
+    }
+
+    /* Codec delay is subtracted from cached frames timecodes, so it's added back for the written file */
+    Uint64 OriginalTimecode(int track_index, const CachedMovieFrame *frame)
+    {
+        const Uint64 codec_delay_ms = GleedMatroskaTicksToMilliseconds(m_movie, m_movie->tracks[track_index].codec_delay);
+
+        return frame->timecode + GleedMillisecondsToTimecode(m_movie, codec_delay_ms);
+    }
+
+    Uint32 FirstFrameAt(int track_index, Uint64 start)
+    {
+        if (track_index == GLEED_NO_TRACK)
+        {
+            return 0;
+        }
+
+        Uint32 frame = 0;
+
+        while (frame < m_movie->count_cached_frames[track_index] && m_movie->cached_frames[track_index][frame].timecode < start)
+        {
+            frame++;
+        }
+
+        return frame;
+    }
+
+    const CachedMovieFrame *FrameBefore(int track_index, Uint32 frame, Uint64 end)
+    {
+        if (track_index == GLEED_NO_TRACK || frame >= m_movie->count_cached_frames[track_index])
+        {
+            return NULL;
+        }
+
+        const CachedMovieFrame *cached = &m_movie->cached_frames[track_index][frame];
+
+        return cached->timecode < end ? cached : NULL;
+    }
+
+    bool WriteFrame(int track_index, const CachedMovieFrame *frame, Uint64 start)
+    {
+        m_frameData.resize(frame->size);
+
+        SDL_LockMutex(m_movie->io_lock);
+        SDL_SeekIO(m_movie->io, frame->offset, SDL_IO_SEEK_SET);
+        const size_t read = SDL_ReadIO(m_movie->io, m_frameData.data(), frame->size);
+        SDL_UnlockMutex(m_movie->io_lock);
+
+        if (read != frame->size)
+        {
+            return GleedSetError("Failed to read frame data: %s", SDL_GetError());
+        }
+
+        const bool is_video = track_index == m_movie->current_video_track;
+        const mkvmuxer::uint64 track_number = is_video ? m_videoTrackNumber : m_audioTrackNumber;
+
+        /* Many files have unreliable keyframe flags, so we trust the bitstream when possible */
+        bool key_frame = is_video ? frame->key_frame : true;
+        GleedDetectKeyFrame(is_video ? m_movie->video_codec : m_movie->audio_codec, m_frameData.data(), frame->size, &key_frame);
+
+        const mkvmuxer::uint64 timestamp_ns = (OriginalTimecode(track_index, frame) - start) * m_movie->timecode_scale;
+
+        if (!m_segment.AddFrame(m_frameData.data(), frame->size, track_number, timestamp_ns, key_frame))
+        {
+            return GleedSetError("Failed to write frame to WebM muxer");
+        }
+
+        return true;
+    }
+
+    GleedMovie *m_movie;
+    mkvmuxer::IMkvWriter *m_writer;
+    mkvmuxer::Segment m_segment;
+
+    mkvmuxer::uint64 m_videoTrackNumber = 0;
+    mkvmuxer::uint64 m_audioTrackNumber = 0;
+
+    std::vector<Uint8> m_frameData;
+};
+
+extern "C"
+{
+    bool GleedExtractClip(GleedMovie *movie, SDL_IOStream *output, Uint64 start_ms, Uint64 end_ms)
+    {
+        if (!movie || !output)
+        {
+            return GleedSetError("movie and output cannot be NULL");
+        }
+
+        if (end_ms <= start_ms)
+        {
+            return GleedSetError("Clip end must be after its start");
+        }
+
+        Uint64 start = GleedMillisecondsToTimecode(movie, start_ms);
+        const Uint64 end = GleedMillisecondsToTimecode(movie, end_ms);
+
+        /* Video can only be decoded from a keyframe, so the clip is extended back to the preceding one */
+        if (movie->current_video_track != GLEED_NO_TRACK)
+        {
+            const CachedMovieFrame *frames = movie->cached_frames[movie->current_video_track];
+            Uint64 keyframe_start = 0;
+
+            for (Uint32 i = 0; i < movie->count_cached_frames[movie->current_video_track] && frames[i].timecode <= start; i++)
+            {
+                if (frames[i].key_frame)
+                {
+                    keyframe_start = frames[i].timecode;
+                }
+            }
+
+            start = keyframe_start;
+        }
+
+        SDLMkvWriter writer(output);
+        GleedMovieMuxer muxer(movie, &writer);
+
+        return muxer.Begin() && muxer.CopyFrames(start, end) && muxer.Finish();
+    }
+
+    bool GleedRemuxForPlayback(GleedMovie *movie, SDL_IOStream *output)
+    {
+        if (!movie || !output)
+        {
+            return GleedSetError("movie and output cannot be NULL");
+        }
+
+        /* Cues size is only known after all clusters are written, so the segment is muxed into memory first */
+        SDL_IOStream *temp = SDL_IOFromDynamicMem();
+
+        if (!temp)
+        {
+            return GleedSetError("Failed to create temporary remux stream: %s", SDL_GetError());
+        }
+
+        SDLMkvWriter temp_writer(temp);
+        SDLMkvReader temp_reader(temp);
+        SDLMkvWriter writer(output);
+
+        GleedMovieMuxer muxer(movie, &temp_writer);
+
+        const bool result = muxer.Begin() &&
+                            muxer.CopyFrames(0, SDL_MAX_UINT64) &&
+                            muxer.Finish() &&
+                            muxer.MoveCuesToFront(&temp_reader, &writer);
+
+        SDL_CloseIO(temp);
+
+        return result;
+    }
+}
@@ -8,16 +8,44 @@ typedef struct
     float *pcm_buffer;
     int pcm_buffer_size;
     int pcm_buffer_size_per_channel;
+    Uint64 pool_key; /**< Output frequency and channels the decoder was created with */
 } MovieOpusContext;
 
+static void GleedDestroyOpusContext(void *decoder)
+{
+    MovieOpusContext *ctx = (MovieOpusContext *)decoder;
+
+    opus_decoder_destroy(ctx->decoder);
+    SDL_free(ctx->pcm_buffer);
+    SDL_free(ctx);
+}
+
+/* Opus decoder only depends on output frequency and channels count */
+static Uint64 GleedOpusPoolKey(const SDL_AudioSpec *spec)
+{
+    return ((Uint64)spec->freq << 8) | (Uint64)spec->channels;
+}
+
 bool GleedDecodeOpus(GleedMovie *movie)
 {
+    if (!movie->opus_context)
+    {
+        movie->opus_context = GleedAcquirePooledDecoder(GLEED_CODEC_TYPE_OPUS, GleedOpusPoolKey(&movie->audio_spec));
+    }
+
     if (!movie->opus_context)
     {
         movie->opus_context = SDL_calloc(1, sizeof(MovieOpusContext));
 
+        if (!movie->opus_context)
+        {
+            return GleedSetError("Failed to allocate memory for Opus context");
+        }
+
         MovieOpusContext *ctx = (MovieOpusContext *)movie->opus_context;
 
+        ctx->pool_key = GleedOpusPoolKey(&movie->audio_spec);
+
         int decoderInitError;
 
         ctx->decoder = opus_decoder_create(movie->audio_spec.freq, movie->audio_spec.channels, &decoderInitError);
@@ -77,13 +105,22 @@ bool GleedDecodeOpus(GleedMovie *movie)
     return true;
 }
 
+void GleedResetOpus(GleedMovie *movie)
+{
+    if (movie->opus_context)
+    {
+        MovieOpusContext *ctx = (MovieOpusContext *)movie->opus_context;
+        opus_decoder_ctl(ctx->decoder, OPUS_RESET_STATE);
+    }
+}
+
 void GleedCloseOpus(GleedMovie *movie)
 {
     if (movie->opus_context)
     {
         MovieOpusContext *ctx = (MovieOpusContext *)movie->opus_context;
-        opus_decoder_destroy(ctx->decoder);
-        SDL_free(movie->opus_context);
+        opus_decoder_ctl(ctx->decoder, OPUS_RESET_STATE);
+        GleedReleasePooledDecoder(GLEED_CODEC_TYPE_OPUS, ctx->pool_key, ctx, GleedDestroyOpusContext);
         movie->opus_context = NULL;
     }
 }
\ No newline at end of file
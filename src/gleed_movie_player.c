@@ -2,6 +2,22 @@
 
 #define GLEED_PLAYER_SOUND_PRELOAD_MS 50
 
+/* Quality levels of adaptive quality, each one also includes the previous ones */
+#define GLEED_QUALITY_LEVEL_SKIP_FILTERS 1 /* Skip loop filter and VP8 postprocessing */
+#define GLEED_QUALITY_LEVEL_DROP_FRAMES 2  /* Do not convert frames which are superseded within the same update */
+#define GLEED_QUALITY_MAX_LEVEL 2
+
+/* Share of the frame interval spent decoding, above which quality is lowered, and below which it's restored */
+#define GLEED_QUALITY_DEGRADE_LOAD 0.85
+#define GLEED_QUALITY_RESTORE_LOAD 0.45
+
+/* Restoring waits longer than lowering, so that a short calm scene doesn't bring quality back right before a busy one */
+#define GLEED_QUALITY_DEGRADE_DELAY_MS 500
+#define GLEED_QUALITY_RESTORE_DELAY_MS 3000
+
+/* Weight of the newest sample in moving averages of frame cost and interval */
+#define GLEED_QUALITY_AVERAGE_WEIGHT 0.1
+
 static bool check_player(GleedMoviePlayer *player)
 {
     return player && player->mov;
@@ -51,12 +67,138 @@ GleedMoviePlayer *GleedCreatePlayerFromIO(SDL_IOStream *io)
     return GleedCreatePlayer(mov);
 }
 
-void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov)
+/* Movie ends when its last video frame stops being displayed, or with its last audio frame if there is no video */
+static Uint64 GleedGetMovieEndTime(GleedMovie *mov)
 {
-    if (!player || !mov)
+    GleedMovieTrack *video_track = GleedGetVideoTrack(mov);
+
+    if (video_track && mov->count_cached_frames[mov->current_video_track] > 0)
+    {
+        const CachedMovieFrame *frames = mov->cached_frames[mov->current_video_track];
+        const Uint32 count = mov->count_cached_frames[mov->current_video_track];
+        const Uint64 last = GleedTimecodeToMilliseconds(mov, frames[count - 1].timecode);
+
+        Uint64 frame_duration = 0;
+
+        if (video_track->video_frame_rate > 0)
+        {
+            frame_duration = (Uint64)(1000.0 / video_track->video_frame_rate);
+        }
+        else if (count > 1)
+        {
+            frame_duration = last - GleedTimecodeToMilliseconds(mov, frames[count - 2].timecode);
+        }
+
+        return last + frame_duration;
+    }
+
+    if (GleedGetAudioTrack(mov) && mov->count_cached_frames[mov->current_audio_track] > 0)
+    {
+        const Uint32 count = mov->count_cached_frames[mov->current_audio_track];
+        return GleedTimecodeToMilliseconds(mov, mov->cached_frames[mov->current_audio_track][count - 1].timecode);
+    }
+
+    return 0;
+}
+
+/* Index of the first visible video frame at or after the given one, total_frames if there is none */
+static Uint32 GleedFindVisibleVideoFrame(GleedMovie *mov, Uint32 index)
+{
+    const CachedMovieFrame *frames = mov->cached_frames[mov->current_video_track];
+
+    while (index < mov->total_frames && !frames[index].visible)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+/* Sets decoder options of the current movie to the full quality ones, reduced by the current quality level */
+static void GleedApplyQualityLevel(GleedMoviePlayer *player)
+{
+    GleedVideoDecoderOptions options = player->quality_base_options;
+
+    if (player->quality_level >= GLEED_QUALITY_LEVEL_SKIP_FILTERS)
+    {
+        options.skip_loop_filter = true;
+        options.vp8_postproc = false;
+    }
+
+    GleedSetVideoDecoderOptions(player->mov, &options);
+}
+
+/* Takes time spent decoding a frame, and interval to the next frame (0 if unknown) */
+static void GleedUpdateAdaptiveQuality(GleedMoviePlayer *player, double frame_cost_ms, double frame_interval_ms)
+{
+    player->frame_cost_ms = player->frame_cost_ms > 0
+                                ? player->frame_cost_ms + (frame_cost_ms - player->frame_cost_ms) * GLEED_QUALITY_AVERAGE_WEIGHT
+                                : frame_cost_ms;
+
+    if (frame_interval_ms > 0)
+    {
+        player->frame_interval_ms = player->frame_interval_ms > 0
+                                        ? player->frame_interval_ms + (frame_interval_ms - player->frame_interval_ms) * GLEED_QUALITY_AVERAGE_WEIGHT
+                                        : frame_interval_ms;
+    }
+
+    if (player->frame_interval_ms <= 0)
+    {
+        return;
+    }
+
+    const double load = player->frame_cost_ms / player->frame_interval_ms;
+
+    /* Movie time starts over with each playlist movie */
+    const Uint64 since_change = player->current_time >= player->quality_level_changed_at ? player->current_time - player->quality_level_changed_at : 0;
+
+    if (load > GLEED_QUALITY_DEGRADE_LOAD && player->quality_level < GLEED_QUALITY_MAX_LEVEL && since_change >= GLEED_QUALITY_DEGRADE_DELAY_MS)
+    {
+        player->quality_level++;
+    }
+    else if (load < GLEED_QUALITY_RESTORE_LOAD && player->quality_level > 0 && since_change >= GLEED_QUALITY_RESTORE_DELAY_MS)
+    {
+        player->quality_level--;
+    }
+    else
+    {
         return;
+    }
+
+    player->quality_level_changed_at = player->current_time;
+
+    GleedApplyQualityLevel(player);
+}
+
+/*
+    Restarts the player with another movie. Playlist switches keep audio queued in the output stream,
+    so the end of the previous movie is still heard while the next one starts.
+*/
+static void GleedSwitchPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov, bool clear_audio)
+{
+    GleedMovie *previous = player->mov;
+    const bool movie_changed = previous != mov;
+
+    if (player->owns_movie && previous && previous != mov)
+    {
+        GleedFreeMovie(previous, true);
+        previous = NULL;
+    }
+
+    /* Setting the same movie again keeps it owned */
+    player->owns_movie = player->owns_movie && previous == mov;
+
+    /* Buffer is sized for the audio format of the movie it was created for */
+    if (player->audio_buffer && (!previous || previous->audio_spec.freq != mov->audio_spec.freq || previous->audio_spec.channels != mov->audio_spec.channels))
+    {
+        SDL_free(player->audio_buffer);
+        player->audio_buffer = NULL;
+        player->audio_buffer_capacity = 0;
+    }
 
     player->mov = mov;
+    player->audio_buffer_count = 0;
+    player->audio_started = false;
     player->current_time = 0;
     player->next_video_frame_at = 0;
     player->next_audio_frame_at = 0;
@@ -67,6 +209,45 @@ void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov)
     /*Ideally, we should not do this, but for now let's assume player always plays movie from start*/
     GleedSeekFrame(player->mov, 0);
 
+    /* Hardware stays the same, so the new movie starts at the current quality level */
+    if (player->adaptive_quality)
+    {
+        /* Same movie still has options of the current quality level, which are not its full quality ones */
+        if (movie_changed)
+        {
+            GleedGetVideoDecoderOptions(mov, &player->quality_base_options);
+        }
+
+        player->quality_level_changed_at = 0;
+
+        GleedApplyQualityLevel(player);
+    }
+
+    /* Frame copy is only blitted into afterwards, so it must match the new video size */
+    if (player->current_video_frame_surface && mov->current_frame_surface &&
+        (player->current_video_frame_surface->w != mov->current_frame_surface->w || player->current_video_frame_surface->h != mov->current_frame_surface->h))
+    {
+        SDL_DestroySurface(player->current_video_frame_surface);
+        player->current_video_frame_surface = NULL;
+    }
+
+    /* Movie starts over, so its decoder may still be switched to the output frequency */
+    if (player->audio_output_frequency)
+    {
+        GleedMatchPlayerOpusFrequency(player, player->audio_output_frequency);
+    }
+
+    /* Device side of the stream stays the same, only samples coming from the movie may change */
+    if (player->output_audio_stream && player->audio_playback)
+    {
+        if (clear_audio)
+        {
+            SDL_ClearAudioStream(player->output_audio_stream);
+        }
+
+        SDL_SetAudioStreamFormat(player->output_audio_stream, &mov->audio_spec, NULL);
+    }
+
     GleedMovieTrack *audio_track = GleedGetAudioTrack(player->mov);
     GleedMovieTrack *video_track = GleedGetVideoTrack(player->mov);
 
@@ -80,6 +261,212 @@ void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov)
     {
         player->next_video_frame_at = GleedMatroskaTicksToMilliseconds(player->mov, video_track->codec_delay);
     }
+
+    player->movie_end_time = GleedGetMovieEndTime(mov);
+}
+
+void GleedSetPlayerMovie(GleedMoviePlayer *player, GleedMovie *mov)
+{
+    if (!player || !mov)
+        return;
+
+    GleedSwitchPlayerMovie(player, mov, true);
+}
+
+static int GleedPlaylistPreloadWorker(void *data)
+{
+    GleedMoviePlayer *player = (GleedMoviePlayer *)data;
+
+    GleedMovie *mov = GleedOpen(player->preload_file);
+
+    /* Audio output is already set up for the current movie, so the next one is decoded the same way */
+    if (mov)
+    {
+        GleedSetOpusDecodeFrequency(mov, player->preload_opus_frequency);
+    }
+
+    /* Decoding the first frames here is what makes the switch itself instant */
+    if (mov && !GleedPrepareMovie(mov))
+    {
+        GleedFreeMovie(mov, true);
+        mov = NULL;
+    }
+
+    if (!mov)
+    {
+        /* Errors are per thread, so we carry it over to the one which switches movies */
+        SDL_strlcpy(player->preload_error, GleedGetError(), sizeof(player->preload_error));
+    }
+
+    player->preloaded_movie = mov;
+
+    return 0;
+}
+
+/* Starts preloading the next playlist movie, unless one is already pending or the playlist is over */
+static bool GleedStartPlaylistPreload(GleedMoviePlayer *player)
+{
+    if (player->preload_thread)
+    {
+        return true;
+    }
+
+    if (player->playlist_next >= player->playlist_count)
+    {
+        if (!player->playlist_loop || player->playlist_count == 0)
+        {
+            return true;
+        }
+
+        player->playlist_next = 0;
+    }
+
+    player->preload_file = player->playlist[player->playlist_next];
+    player->preload_opus_frequency = player->mov->opus_decode_frequency;
+    player->preloaded_movie = NULL;
+    player->preload_error[0] = '\0';
+
+    player->preload_thread = SDL_CreateThread(GleedPlaylistPreloadWorker, "GleedPlaylistPreload", player);
+
+    if (!player->preload_thread)
+    {
+        return GleedSetError("Failed to create playlist preload thread: %s", SDL_GetError());
+    }
+
+    player->playlist_next++;
+
+    return true;
+}
+
+/* Waits for the preloaded movie, if it's not ready yet, and makes it the current one */
+static bool GleedSwitchToPreloadedMovie(GleedMoviePlayer *player)
+{
+    SDL_WaitThread(player->preload_thread, NULL);
+    player->preload_thread = NULL;
+
+    GleedMovie *mov = player->preloaded_movie;
+    player->preloaded_movie = NULL;
+
+    if (!mov)
+    {
+        GleedSetError("Failed to preload playlist movie %s: %s", player->preload_file, player->preload_error);
+
+        /* Failed movie is skipped, so the playlist goes on with the following one */
+        GleedStartPlaylistPreload(player);
+        return false;
+    }
+
+    /* Whatever time passed the end of the previous movie is already part of the new one */
+    const Uint64 overshoot = player->current_time - player->movie_end_time;
+
+    GleedSwitchPlayerMovie(player, mov, false);
+
+    player->owns_movie = true;
+    player->current_time = overshoot;
+
+    return GleedStartPlaylistPreload(player);
+}
+
+bool GleedAddPlayerPlaylistFile(GleedMoviePlayer *player, const char *file)
+{
+    if (!check_player(player))
+        return SDL_SetError("Invalid player");
+
+    if (!file)
+        return GleedSetError("file cannot be NULL");
+
+    if (player->playlist_count == player->playlist_capacity)
+    {
+        const int capacity = player->playlist_capacity ? player->playlist_capacity * 2 : 8;
+        char **playlist = (char **)SDL_realloc(player->playlist, capacity * sizeof(char *));
+
+        if (!playlist)
+        {
+            return GleedSetError("Failed to allocate memory for playlist");
+        }
+
+        player->playlist = playlist;
+        player->playlist_capacity = capacity;
+    }
+
+    char *path = SDL_strdup(file);
+
+    if (!path)
+    {
+        return GleedSetError("Failed to allocate memory for playlist entry");
+    }
+
+    player->playlist[player->playlist_count++] = path;
+
+    return GleedStartPlaylistPreload(player);
+}
+
+void GleedSetPlayerPlaylistLoop(GleedMoviePlayer *player, bool loop)
+{
+    if (!check_player(player))
+        return;
+
+    player->playlist_loop = loop;
+
+    GleedStartPlaylistPreload(player);
+}
+
+void GleedClearPlayerPlaylist(GleedMoviePlayer *player)
+{
+    if (!check_player(player))
+        return;
+
+    if (player->preload_thread)
+    {
+        SDL_WaitThread(player->preload_thread, NULL);
+        player->preload_thread = NULL;
+    }
+
+    if (player->preloaded_movie)
+    {
+        GleedFreeMovie(player->preloaded_movie, true);
+        player->preloaded_movie = NULL;
+    }
+
+    for (int i = 0; i < player->playlist_count; i++)
+    {
+        SDL_free(player->playlist[i]);
+    }
+
+    player->playlist_count = 0;
+    player->playlist_next = 0;
+}
+
+void GleedSetPlayerAdaptiveQuality(GleedMoviePlayer *player, bool enabled)
+{
+    if (!check_player(player) || player->adaptive_quality == enabled)
+        return;
+
+    if (enabled)
+    {
+        GleedGetVideoDecoderOptions(player->mov, &player->quality_base_options);
+
+        player->frame_cost_ms = 0;
+        player->frame_interval_ms = 0;
+        player->quality_level_changed_at = player->current_time;
+    }
+
+    player->adaptive_quality = enabled;
+    player->quality_level = 0;
+
+    /* Turning it off brings full quality back */
+    if (!enabled)
+    {
+        GleedApplyQualityLevel(player);
+    }
+}
+
+int GleedGetPlayerQualityLevel(GleedMoviePlayer *player)
+{
+    if (!player)
+        return 0;
+
+    return player->quality_level;
 }
 
 void GleedFreePlayer(GleedMoviePlayer *player)
@@ -90,7 +477,11 @@ void GleedFreePlayer(GleedMoviePlayer *player)
     if (player->audio_buffer)
         SDL_free(player->audio_buffer);
 
-    if (player->output_audio_stream)
+    if (player->audio_mixer)
+    {
+        GleedRemovePlayerFromMixer(player->audio_mixer, player);
+    }
+    else if (player->output_audio_stream)
     {
         SDL_DestroyAudioStream(player->output_audio_stream);
     }
@@ -100,6 +491,14 @@ void GleedFreePlayer(GleedMoviePlayer *player)
         SDL_DestroySurface(player->current_video_frame_surface);
     }
 
+    GleedClearPlayerPlaylist(player);
+    SDL_free(player->playlist);
+
+    if (player->owns_movie)
+    {
+        GleedFreeMovie(player->mov, true);
+    }
+
     SDL_free(player);
 }
 
@@ -112,7 +511,8 @@ GleedMoviePlayerUpdateResult GleedUpdatePlayer(GleedMoviePlayer *player, int tim
     if (time_delta_ms == 0)
         return GLEED_PLAYER_UPDATE_NONE;
 
-    if (player->paused || player->finished)
+    /* Finished player keeps counting time if there is a playlist movie to switch to */
+    if (SDL_GetAtomicInt(&player->paused) || (player->finished && !player->preload_thread))
         return GLEED_PLAYER_UPDATE_NONE;
 
     GleedMoviePlayerUpdateResult result = GLEED_PLAYER_UPDATE_NONE;
@@ -129,6 +529,17 @@ GleedMoviePlayerUpdateResult GleedUpdatePlayer(GleedMoviePlayer *player, int tim
     */
     player->last_frame_at_ticks = SDL_GetTicks();
 
+    if (player->preload_thread && player->current_time >= player->movie_end_time)
+    {
+        if (!GleedSwitchToPreloadedMovie(player))
+        {
+            return GLEED_PLAYER_UPDATE_ERROR;
+        }
+    }
+
+    if (player->finished)
+        return GLEED_PLAYER_UPDATE_NONE;
+
     if (player->video_playback && GleedCanPlaybackVideo(player->mov) && player->current_time >= player->next_video_frame_at)
     {
         CachedMovieFrame *next_frame_to_play = GleedGetCurrentCachedFrame(
@@ -145,36 +556,82 @@ GleedMoviePlayerUpdateResult GleedUpdatePlayer(GleedMoviePlayer *player, int tim
         */
         while (GleedHasNextVideoFrame(player->mov) && next_frame_to_play && GleedTimecodeToMilliseconds(player->mov, next_frame_to_play->timecode) <= player->current_time)
         {
-            if (!GleedDecodeVideoFrame(player->mov))
+            const Uint64 frame_at = GleedTimecodeToMilliseconds(player->mov, next_frame_to_play->timecode);
+
+            /*
+                Frame followed by another one due in this update is never shown, so dropping it only skips its conversion.
+                Decoding goes through invisible frames, so both the decoded frame and the following one are the next visible ones.
+            */
+            if (player->quality_level >= GLEED_QUALITY_LEVEL_DROP_FRAMES)
+            {
+                const Uint32 shown_frame = GleedFindVisibleVideoFrame(player->mov, player->mov->current_frame);
+                const Uint32 following_frame = GleedFindVisibleVideoFrame(player->mov, shown_frame + 1);
+
+                player->mov->drop_video_conversion = following_frame < player->mov->total_frames &&
+                                                     GleedTimecodeToMilliseconds(player->mov, player->mov->cached_frames[player->mov->current_video_track][following_frame].timecode) <= player->current_time;
+            }
+
+            const Uint64 decode_start = SDL_GetTicksNS();
+
+            const bool decoded = GleedDecodeVideoFrame(player->mov);
+
+            const Uint64 decode_ns = SDL_GetTicksNS() - decode_start;
+
+            player->mov->drop_video_conversion = false;
+
+            if (!decoded)
             {
                 return GLEED_PLAYER_UPDATE_ERROR;
             }
             GleedNextVideoFrame(player->mov);
             next_frame_to_play = GleedGetCurrentCachedFrame(
                 player->mov, GLEED_TRACK_TYPE_VIDEO);
-        }
 
-        /* Either create a surface or just blit it*/
-        if (!player->current_video_frame_surface)
-        {
-            player->current_video_frame_surface = SDL_DuplicateSurface(
-                (SDL_Surface *)GleedGetVideoFrameSurface(player->mov));
-        }
-        else
-        {
-            SDL_BlitSurface(
-                (SDL_Surface *)GleedGetVideoFrameSurface(player->mov),
-                NULL,
-                player->current_video_frame_surface,
-                NULL);
+            if (player->adaptive_quality)
+            {
+                const double frame_interval_ms = next_frame_to_play ? (double)GleedTimecodeToMilliseconds(player->mov, next_frame_to_play->timecode) - frame_at : 0;
+
+                GleedUpdateAdaptiveQuality(player, decode_ns / 1000000.0, frame_interval_ms);
+            }
         }
 
-        /* If user set a target texture, update it's contents*/
-        if (player->output_video_frame_texture)
+        /* Frame surface keeps the last converted frame while conversion is disabled, so there's nothing new to show */
+        if (!player->mov->skip_video_conversion)
         {
-            GleedUpdatePlaybackTexture(
-                player->mov,
-                player->output_video_frame_texture);
+            SDL_Surface *frame_surface = (SDL_Surface *)GleedGetVideoFrameSurface(player->mov);
+
+            /* Either create a surface or just blit it */
+            if (frame_surface && !player->current_video_frame_surface)
+            {
+                player->current_video_frame_surface = SDL_DuplicateSurface(frame_surface);
+            }
+            else if (frame_surface)
+            {
+                SDL_BlitSurface(frame_surface, NULL, player->current_video_frame_surface, NULL);
+            }
+
+            /*
+                If user set target textures, update the next one in rotation.
+
+                The texture which was presented last is left untouched, so the upload never waits
+                for the GPU to finish reading it. With a single texture this always updates the same one.
+            */
+            if (player->output_video_frame_textures_count > 0)
+            {
+                const int next_texture = (player->ready_video_frame_texture + 1) % player->output_video_frame_textures_count;
+
+                /* Rotated textures each miss the frames uploaded into the others, so they can't take partial updates */
+                if (GleedUploadPlaybackTexture(
+                        player->mov,
+                        player->output_video_frame_textures[next_texture],
+                        player->output_video_frame_textures_count > 1))
+                {
+                    player->ready_video_frame_texture = next_texture;
+                    player->output_texture_uploaded = true;
+                }
+            }
+
+            player->atlas_frame_pending = true;
         }
 
         if (next_frame_to_play)
@@ -217,6 +674,8 @@ GleedMoviePlayerUpdateResult GleedUpdatePlayer(GleedMoviePlayer *player, int tim
                 return GLEED_PLAYER_UPDATE_ERROR;
             }
 
+            player->audio_started = true;
+
             int samples_count;
 
             const GleedMovieAudioSample *samples = GleedGetAudioSamples(player->mov, NULL, &samples_count);
@@ -289,6 +748,29 @@ void GleedAddAudioSamplesToPlayer(
     player->audio_buffer_count += count;
 }
 
+void GleedMatchPlayerOpusFrequency(GleedMoviePlayer *player, int frequency)
+{
+    GleedMovie *mov = player->mov;
+
+    if (mov->audio_codec != GLEED_CODEC_TYPE_OPUS || player->audio_started || !GleedIsOpusDecodeFrequency(frequency))
+    {
+        return;
+    }
+
+    if (mov->opus_decode_frequency == frequency)
+    {
+        return;
+    }
+
+    GleedSetOpusDecodeFrequency(mov, frequency);
+
+    /* Buffer holds a second of samples at the decode frequency, so it's allocated again on the next samples */
+    SDL_free(player->audio_buffer);
+    player->audio_buffer = NULL;
+    player->audio_buffer_capacity = 0;
+    player->audio_buffer_count = 0;
+}
+
 bool GleedSetPlayerAudioOutput(GleedMoviePlayer *player, SDL_AudioDeviceID dev)
 {
     if (!check_player(player))
@@ -304,13 +786,19 @@ bool GleedSetPlayerAudioOutput(GleedMoviePlayer *player, SDL_AudioDeviceID dev)
         return GleedSetError("No audio track selected");
     }
 
-    if (player->output_audio_stream)
+    if (player->audio_mixer)
+    {
+        GleedRemovePlayerFromMixer(player->audio_mixer, player);
+    }
+    else if (player->output_audio_stream)
     {
         SDL_DestroyAudioStream(player->output_audio_stream);
         player->output_audio_stream = NULL;
         player->bound_audio_device = 0;
     }
 
+    player->audio_output_frequency = 0;
+
     /* If zero was provided for device id - user wants to stop audio output */
     if (!dev)
     {
@@ -331,6 +819,10 @@ bool GleedSetPlayerAudioOutput(GleedMoviePlayer *player, SDL_AudioDeviceID dev)
 
     player->audio_output_samples_buffer_ms = ((Sint64)player->audio_output_samples_buffer_size * 1000) / dst_audio_spec.freq;
 
+    player->audio_output_frequency = dst_audio_spec.freq;
+
+    GleedMatchPlayerOpusFrequency(player, dst_audio_spec.freq);
+
     player->output_audio_stream = SDL_CreateAudioStream(
         &player->mov->audio_spec, &dst_audio_spec);
 
@@ -371,9 +863,10 @@ void GleedPausePlayer(GleedMoviePlayer *player)
     if (!check_player(player))
         return;
 
-    player->paused = true;
+    SDL_SetAtomicInt(&player->paused, 1);
 
-    if (player->output_audio_stream)
+    /* Mixer skips paused players on its own */
+    if (player->output_audio_stream && !player->audio_mixer)
     {
         SDL_UnbindAudioStream(player->output_audio_stream);
     }
@@ -384,10 +877,10 @@ void GleedResumePlayer(GleedMoviePlayer *player)
     if (!check_player(player))
         return;
 
-    player->paused = false;
+    SDL_SetAtomicInt(&player->paused, 0);
     player->last_frame_at_ticks = SDL_GetTicks();
 
-    if (player->output_audio_stream)
+    if (player->output_audio_stream && !player->audio_mixer)
     {
         SDL_BindAudioStream(player->bound_audio_device, player->output_audio_stream);
     }
@@ -398,7 +891,7 @@ bool GleedIsPlayerPaused(GleedMoviePlayer *player)
     if (!check_player(player))
         return false;
 
-    return player->paused;
+    return SDL_GetAtomicInt(&player->paused) != 0;
 }
 
 float GleedGetPlayerCurrentTimeSeconds(GleedMoviePlayer *player)
@@ -420,31 +913,75 @@ Uint64 GleedGetPlayerCurrentTime(GleedMoviePlayer *player)
 bool GleedSetPlayerVideoOutputTexture(
     GleedMoviePlayer *player,
     SDL_Texture *texture)
+{
+    return GleedSetPlayerVideoOutputTextures(player, texture ? &texture : NULL, texture ? 1 : 0);
+}
+
+bool GleedSetPlayerVideoOutputTextures(
+    GleedMoviePlayer *player,
+    SDL_Texture **textures,
+    int count)
 {
     if (!check_player(player))
         return SDL_SetError("Invalid player");
 
-    if (texture == NULL)
+    if (textures == NULL || count == 0)
     {
-        player->output_video_frame_texture = NULL;
+        player->output_video_frame_textures_count = 0;
+        player->ready_video_frame_texture = 0;
+        player->output_texture_uploaded = false;
         return true;
     }
 
+    if (count < 0 || count > GLEED_PLAYER_MAX_OUTPUT_TEXTURES)
+    {
+        return SDL_SetError("Output textures count must be between 1 and %d", GLEED_PLAYER_MAX_OUTPUT_TEXTURES);
+    }
+
     if (!player->mov->current_frame_surface)
     {
         return SDL_SetError("No video playback available, check if video track is selected");
     }
 
-    if (texture->format != player->mov->current_frame_surface->format)
+    for (int i = 0; i < count; i++)
+    {
+        if (!textures[i])
+        {
+            return SDL_SetError("Output texture %d is NULL", i);
+        }
+
+        if (textures[i]->format != player->mov->current_frame_surface->format)
+        {
+            return SDL_SetError("Texture format does not match the video frame format");
+        }
+    }
+
+    for (int i = 0; i < count; i++)
     {
-        return SDL_SetError("Texture format does not match the video frame format");
+        player->output_video_frame_textures[i] = textures[i];
     }
 
-    player->output_video_frame_texture = texture;
+    player->output_video_frame_textures_count = count;
+
+    /* Start so that the first update writes into the first texture */
+    player->ready_video_frame_texture = count - 1;
+    player->output_texture_uploaded = false;
 
     return true;
 }
 
+SDL_Texture *GleedGetPlayerVideoOutputTexture(GleedMoviePlayer *player)
+{
+    if (!check_player(player))
+        return NULL;
+
+    /* Textures hold whatever they were created with until the first frame is uploaded */
+    if (player->output_video_frame_textures_count == 0 || !player->output_texture_uploaded)
+        return NULL;
+
+    return player->output_video_frame_textures[player->ready_video_frame_texture];
+}
+
 const SDL_Surface *GleedGetPlayerCurrentVideoFrameSurface(
     GleedMoviePlayer *player)
 {
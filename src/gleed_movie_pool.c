@@ -0,0 +1,117 @@
+#include "gleed_movie_internal.h"
+
+typedef struct
+{
+    GleedMovieCodecType codec;       /**< Codec the decoder was created for */
+    Uint64 key;                      /**< Parameters the decoder was created with */
+    void *decoder;                   /**< Idle decoder context, already reset */
+    GleedDestroyDecoderFunc destroy; /**< Function to destroy the context */
+} GleedPooledDecoder;
+
+/*
+    Decoders outlive movies, so the pool is shared by the whole process.
+    Entries are ordered from the oldest to the most recently released one.
+*/
+static GleedPooledDecoder pooled_decoders[GLEED_DECODER_POOL_SIZE];
+static int pooled_decoders_count = 0;
+static SDL_SpinLock pool_lock = 0;
+
+Uint64 GleedHashDecoderParams(Uint64 hash, const void *data, size_t size)
+{
+    const Uint8 *bytes = (const Uint8 *)data;
+
+    /* FNV-1a */
+    if (!hash)
+    {
+        hash = 0xcbf29ce484222325ULL;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+void *GleedAcquirePooledDecoder(GleedMovieCodecType codec, Uint64 key)
+{
+    return GleedAcquireMatchingPooledDecoder(codec, key, NULL, NULL);
+}
+
+void *GleedAcquireMatchingPooledDecoder(GleedMovieCodecType codec, Uint64 key, GleedMatchDecoderFunc match, const void *userdata)
+{
+    void *decoder = NULL;
+
+    SDL_LockSpinlock(&pool_lock);
+
+    /* Most recently released decoder is the most likely to still be in CPU caches */
+    for (int i = pooled_decoders_count - 1; i >= 0; i--)
+    {
+        if (pooled_decoders[i].codec == codec && pooled_decoders[i].key == key &&
+            (!match || match(pooled_decoders[i].decoder, userdata)))
+        {
+            decoder = pooled_decoders[i].decoder;
+
+            SDL_memmove(&pooled_decoders[i], &pooled_decoders[i + 1], (pooled_decoders_count - i - 1) * sizeof(GleedPooledDecoder));
+            pooled_decoders_count--;
+            break;
+        }
+    }
+
+    SDL_UnlockSpinlock(&pool_lock);
+
+    return decoder;
+}
+
+void GleedReleasePooledDecoder(GleedMovieCodecType codec, Uint64 key, void *decoder, GleedDestroyDecoderFunc destroy)
+{
+    if (!decoder)
+        return;
+
+    GleedPooledDecoder evicted = {0};
+
+    SDL_LockSpinlock(&pool_lock);
+
+    if (pooled_decoders_count == GLEED_DECODER_POOL_SIZE)
+    {
+        evicted = pooled_decoders[0];
+
+        SDL_memmove(&pooled_decoders[0], &pooled_decoders[1], (GLEED_DECODER_POOL_SIZE - 1) * sizeof(GleedPooledDecoder));
+        pooled_decoders_count--;
+    }
+
+    GleedPooledDecoder *entry = &pooled_decoders[pooled_decoders_count++];
+    entry->codec = codec;
+    entry->key = key;
+    entry->decoder = decoder;
+    entry->destroy = destroy;
+
+    SDL_UnlockSpinlock(&pool_lock);
+
+    /* Destroying a decoder may take a while (e.g. joining its threads), so it's done outside of the lock */
+    if (evicted.decoder)
+    {
+        evicted.destroy(evicted.decoder);
+    }
+}
+
+void GleedClearDecoderPool(void)
+{
+    GleedPooledDecoder decoders[GLEED_DECODER_POOL_SIZE];
+    int count;
+
+    SDL_LockSpinlock(&pool_lock);
+
+    count = pooled_decoders_count;
+    SDL_memcpy(decoders, pooled_decoders, count * sizeof(GleedPooledDecoder));
+    pooled_decoders_count = 0;
+
+    SDL_UnlockSpinlock(&pool_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        decoders[i].destroy(decoders[i].decoder);
+    }
+}
@@ -10,8 +10,33 @@ typedef struct
     vorbis_block vb;
 
     int packet_no;
+    Uint64 pool_key;     /**< Hash of setup headers the decoder was built from */
+    Uint8 *headers;      /**< Copy of setup headers the decoder was built from, a matching hash alone may be a collision */
+    size_t headers_size; /**< Size of headers in bytes */
 } VorbisContext;
 
+static void GleedDestroyVorbisContext(void *decoder)
+{
+    VorbisContext *ctx = (VorbisContext *)decoder;
+
+    vorbis_block_clear(&ctx->vb);
+    vorbis_dsp_clear(&ctx->vd);
+    vorbis_comment_clear(&ctx->vc);
+    vorbis_info_clear(&ctx->vi);
+
+    SDL_free(ctx->headers);
+    SDL_free(ctx);
+}
+
+static bool GleedMatchVorbisHeaders(const void *decoder, const void *userdata)
+{
+    const VorbisContext *ctx = (const VorbisContext *)decoder;
+    const GleedMovieTrack *audio_track = (const GleedMovieTrack *)userdata;
+
+    return ctx->headers_size == audio_track->codec_private_size &&
+           SDL_memcmp(ctx->headers, audio_track->codec_private_data, ctx->headers_size) == 0;
+}
+
 static bool GleedInitVorbis(GleedMovie *movie)
 {
     GleedMovieTrack *audio_track = GleedGetAudioTrack(movie);
@@ -28,7 +53,25 @@ static bool GleedInitVorbis(GleedMovie *movie)
         return GleedSetError("Invalid number of Vorbis initialization packets: %d", vorbis_init_packets_count);
     }
 
-    VorbisContext *ctx = (VorbisContext *)SDL_calloc(1, sizeof(VorbisContext));
+    /* Synthesis setup is fully determined by the headers, so a decoder built from the same ones can be reused */
+    const Uint64 pool_key = GleedHashDecoderParams(0, audio_track->codec_private_data, audio_track->codec_private_size);
+
+    VorbisContext *ctx = (VorbisContext *)GleedAcquireMatchingPooledDecoder(GLEED_CODEC_TYPE_VORBIS, pool_key, GleedMatchVorbisHeaders, audio_track);
+
+    if (ctx)
+    {
+        movie->vorbis_context = ctx;
+        return true;
+    }
+
+    ctx = (VorbisContext *)SDL_calloc(1, sizeof(VorbisContext));
+
+    if (!ctx)
+    {
+        return GleedSetError("Failed to allocate memory for Vorbis context");
+    }
+
+    ctx->pool_key = pool_key;
 
     vorbis_info_init(&ctx->vi);
     vorbis_comment_init(&ctx->vc);
@@ -56,6 +99,8 @@ static bool GleedInitVorbis(GleedMovie *movie)
 
     if (header_in_error != 0)
     {
+        vorbis_comment_clear(&ctx->vc);
+        vorbis_info_clear(&ctx->vi);
         SDL_free(ctx);
         return GleedSetError("Failed to parse Vorbis ID header: %d", header_in_error);
     }
@@ -68,6 +113,8 @@ static bool GleedInitVorbis(GleedMovie *movie)
 
     if (header_in_error != 0)
     {
+        vorbis_comment_clear(&ctx->vc);
+        vorbis_info_clear(&ctx->vi);
         SDL_free(ctx);
         return GleedSetError("Failed to parse Vorbis comment header: %d", header_in_error);
     }
@@ -79,12 +126,16 @@ static bool GleedInitVorbis(GleedMovie *movie)
 
     if (header_in_error != 0)
     {
+        vorbis_comment_clear(&ctx->vc);
+        vorbis_info_clear(&ctx->vi);
         SDL_free(ctx);
         return GleedSetError("Failed to parse Vorbis codebooks header: %d", header_in_error);
     }
 
     if (vorbis_synthesis_init(&ctx->vd, &ctx->vi) != 0)
     {
+        vorbis_comment_clear(&ctx->vc);
+        vorbis_info_clear(&ctx->vi);
         SDL_free(ctx);
         return GleedSetError("Failed to initialize Vorbis synthesis");
     }
@@ -93,10 +144,24 @@ static bool GleedInitVorbis(GleedMovie *movie)
 
     if (block_error != 0)
     {
+        vorbis_dsp_clear(&ctx->vd);
+        vorbis_comment_clear(&ctx->vc);
+        vorbis_info_clear(&ctx->vi);
         SDL_free(ctx);
         return GleedSetError("Failed to initialize Vorbis block: %d", block_error);
     }
 
+    ctx->headers = (Uint8 *)SDL_malloc(audio_track->codec_private_size);
+
+    if (!ctx->headers)
+    {
+        GleedDestroyVorbisContext(ctx);
+        return GleedSetError("Failed to allocate memory for Vorbis headers");
+    }
+
+    SDL_memcpy(ctx->headers, audio_track->codec_private_data, audio_track->codec_private_size);
+    ctx->headers_size = audio_track->codec_private_size;
+
     movie->vorbis_context = ctx;
 
     return true;
@@ -180,12 +245,26 @@ VorbisDecodeResult GleedDecode_Vorbis(GleedMovie *movie)
     return GLEED_VORBIS_DECODE_DONE;
 }
 
+void GleedResetVorbis(GleedMovie *movie)
+{
+    if (movie->vorbis_context)
+    {
+        VorbisContext *ctx = (VorbisContext *)movie->vorbis_context;
+        vorbis_synthesis_restart(&ctx->vd);
+        ctx->packet_no = 0;
+    }
+}
+
 void GleedCloseVorbis(GleedMovie *movie)
 {
     if (movie->vorbis_context)
     {
         VorbisContext *ctx = (VorbisContext *)movie->vorbis_context;
-        SDL_free(movie->vorbis_context);
+
+        vorbis_synthesis_restart(&ctx->vd);
+        ctx->packet_no = 0;
+
+        GleedReleasePooledDecoder(GLEED_CODEC_TYPE_VORBIS, ctx->pool_key, ctx, GleedDestroyVorbisContext);
         movie->vorbis_context = NULL;
     }
 }
\ No newline at end of file
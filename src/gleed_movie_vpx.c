@@ -1,32 +1,43 @@
 #include "gleed_movie_internal.h"
 
 #include <vpx/vpx_decoder.h>
+#include <vpx/vpx_frame_buffer.h>
 #include <vpx/vp8dx.h>
 
+/* Minimum libvpx asks for VP9 (reference frames and work buffers), plus one frame held for pipelined conversion */
+#define GLEED_VPX_FRAME_BUFFERS (VP9_MAXIMUM_REF_BUFFERS + VPX_MAXIMUM_WORK_BUFFERS + 1)
+
+/* Frame buffer VP9 decodes into, so its planes can be kept alive past the next decode call */
 typedef struct
 {
-    vpx_codec_iface_t *vp8;
-    vpx_codec_iface_t *vp9;
-    vpx_codec_ctx_t codec8;
-    vpx_codec_ctx_t codec9;
-} VPXContext;
+    Uint8 *data;
+    size_t size;
+    bool in_use; /**< Referenced by the decoder */
+    bool held;   /**< Planes are still read by pipelined conversion */
+} GleedVPXFrameBuffer;
 
-/* Stolen from libvpx/tools_common.c */
-static int vpx_img_plane_width(const vpx_image_t *img, int plane)
+/* Decoder together with frame buffers it decodes into, as both move between movies through the decoder pool */
+typedef struct
 {
-    if (plane > 0 && img->x_chroma_shift > 0)
-        return (img->d_w + 1) >> img->x_chroma_shift;
-    else
-        return img->d_w;
-}
+    vpx_codec_ctx_t codec;
+    GleedVPXFrameBuffer frame_buffers[GLEED_VPX_FRAME_BUFFERS]; /**< Used by VP9 only, VP8 has no external frame buffers support */
+} GleedVPXDecoder;
 
-static int vpx_img_plane_height(const vpx_image_t *img, int plane)
+/* Decoders are allocated separately, so they can be handed over to the decoder pool */
+typedef struct
 {
-    if (plane > 0 && img->y_chroma_shift > 0)
-        return (img->d_h + 1) >> img->y_chroma_shift;
-    else
-        return img->d_h;
-}
+    GleedVPXDecoder *decoder8;
+    GleedVPXDecoder *decoder9;
+    Uint64 decoder8_key; /**< Pool key of decoder8, derived from options it was created with */
+    Uint64 decoder9_key; /**< Pool key of decoder9 */
+
+    GleedVPXFrameBuffer *last_output_buffer; /**< Buffer of the last VP9 image returned by the decoder */
+    GleedVPXFrameBuffer *held_buffer;        /**< Buffer held by GleedHoldVPXFrame */
+
+    GleedVPXDecoder *retired_decoder;         /**< Replaced decoder, which still owns the held buffer, pooled once it's released */
+    Uint64 retired_decoder_key;               /**< Pool key of the retired decoder */
+    GleedMovieCodecType retired_decoder_type; /**< Codec of the retired decoder */
+} VPXContext;
 
 static SDL_PixelFormat vpx_format_to_sdl_format(vpx_img_fmt_t fmt)
 {
@@ -62,60 +73,271 @@ static SDL_Colorspace vpx_cs_to_sdl_cs(vpx_color_space_t cs)
     }
 }
 
-bool GleedDecodeVPX(GleedMovie *movie)
+/* Called by libvpx whenever VP9 needs a buffer for a new frame */
+static int GleedGetVPXFrameBuffer(void *priv, size_t min_size, vpx_codec_frame_buffer_t *fb)
 {
-    Uint64 decode_start = SDL_GetTicks();
+    GleedVPXDecoder *decoder = (GleedVPXDecoder *)priv;
 
-    if (!movie->vpx_context)
+    for (int i = 0; i < GLEED_VPX_FRAME_BUFFERS; i++)
     {
-        movie->vpx_context = SDL_calloc(1, sizeof(VPXContext));
+        GleedVPXFrameBuffer *buffer = &decoder->frame_buffers[i];
+
+        if (buffer->in_use || buffer->held)
+        {
+            continue;
+        }
+
+        if (buffer->size < min_size)
+        {
+            /* Zeroed, as loop filter of libvpx reads frame borders before they are written */
+            Uint8 *data = (Uint8 *)SDL_calloc(1, min_size);
+
+            if (!data)
+            {
+                return -1;
+            }
+
+            SDL_free(buffer->data);
+            buffer->data = data;
+            buffer->size = min_size;
+        }
+
+        buffer->in_use = true;
+
+        fb->data = buffer->data;
+        fb->size = buffer->size;
+        fb->priv = buffer;
+
+        return 0;
     }
 
-    vpx_codec_iface_t *vpi = NULL;
-    vpx_codec_ctx_t *codec = NULL;
+    return -1;
+}
 
-    VPXContext *ctx = (VPXContext *)movie->vpx_context;
+static int GleedReleaseVPXFrameBuffer(void *priv, vpx_codec_frame_buffer_t *fb)
+{
+    GleedVPXFrameBuffer *buffer = (GleedVPXFrameBuffer *)fb->priv;
 
-    if (movie->video_codec == GLEED_CODEC_TYPE_VP8)
+    buffer->in_use = false;
+
+    return 0;
+}
+
+static void GleedDestroyVPXCodec(void *decoder)
+{
+    GleedVPXDecoder *vpx_decoder = (GleedVPXDecoder *)decoder;
+
+    vpx_codec_destroy(&vpx_decoder->codec);
+
+    for (int i = 0; i < GLEED_VPX_FRAME_BUFFERS; i++)
+    {
+        SDL_free(vpx_decoder->frame_buffers[i].data);
+    }
+
+    SDL_free(vpx_decoder);
+}
+
+/* Options which can only be set when a decoder is created, so decoders with different ones are kept apart in the pool */
+static Uint64 GleedGetVPXPoolKey(GleedMovieCodecType codec_type, const GleedVideoDecoderOptions *options)
+{
+    int params[4] = {0};
+
+    if (codec_type == GLEED_CODEC_TYPE_VP8)
     {
-        if (!ctx->vp8)
+        params[0] = options->vp8_postproc;
+    }
+    else
+    {
+        params[1] = options->vp9_threads;
+        params[2] = options->vp9_row_mt;
+        params[3] = options->vp9_loop_filter_opt;
+    }
+
+    return GleedHashDecoderParams(0, params, sizeof(params));
+}
+
+static GleedVPXDecoder *GleedCreateVPXCodec(GleedMovieCodecType codec_type, const GleedVideoDecoderOptions *options, Uint64 key)
+{
+    GleedVPXDecoder *decoder = (GleedVPXDecoder *)GleedAcquirePooledDecoder(codec_type, key);
+
+    if (decoder)
+    {
+        return decoder;
+    }
+
+    decoder = (GleedVPXDecoder *)SDL_calloc(1, sizeof(GleedVPXDecoder));
+
+    if (!decoder)
+    {
+        GleedSetError("Failed to allocate memory for VPX decoder");
+        return NULL;
+    }
+
+    const bool vp8 = codec_type == GLEED_CODEC_TYPE_VP8;
+
+    vpx_codec_dec_cfg_t cfg;
+    SDL_zero(cfg);
+    cfg.threads = vp8 ? 0 : options->vp9_threads;
+
+    const vpx_codec_flags_t flags = vp8 && options->vp8_postproc ? VPX_CODEC_USE_POSTPROC : 0;
+
+    vpx_codec_err_t init_err = vpx_codec_dec_init(&decoder->codec, vp8 ? vpx_codec_vp8_dx() : vpx_codec_vp9_dx(), &cfg, flags);
+
+    if (init_err != VPX_CODEC_OK)
+    {
+        GleedSetError("Failed to initialize %s decoder: %s", vp8 ? "VP8" : "VP9", vpx_codec_err_to_string(init_err));
+        SDL_free(decoder);
+        return NULL;
+    }
+
+    /* Frames decoded into our own buffers can be held while the following ones are decoded */
+    if (!vp8)
+    {
+        init_err = vpx_codec_set_frame_buffer_functions(&decoder->codec, GleedGetVPXFrameBuffer, GleedReleaseVPXFrameBuffer, decoder);
+
+        if (init_err != VPX_CODEC_OK)
         {
-            ctx->vp8 = vpx_codec_vp8_dx();
+            GleedSetError("Failed to set VP9 frame buffer functions: %s", vpx_codec_err_to_string(init_err));
+            vpx_codec_destroy(&decoder->codec);
+            SDL_free(decoder);
+            return NULL;
+        }
+
+        /* Both are read when the decoder starts, before the first frame - and ignored by decoders built without them */
+        vpx_codec_control(&decoder->codec, VP9D_SET_ROW_MT, options->vp9_row_mt ? 1 : 0);
+        vpx_codec_control(&decoder->codec, VP9D_SET_LOOP_FILTER_OPT, options->vp9_loop_filter_opt ? 1 : 0);
+    }
+
+    return decoder;
+}
+
+/*
+    VPX decoders have no reset call, but playback and seeking always start from a keyframe,
+    which replaces all reference frames, so only frames still pending in the decoder must be dropped.
+*/
+static void GleedReleaseVPXCodec(GleedMovieCodecType codec_type, GleedVPXDecoder *decoder, Uint64 key)
+{
+    if (!decoder)
+        return;
+
+    vpx_codec_iter_t iter = NULL;
+
+    vpx_codec_decode(&decoder->codec, NULL, 0, NULL, 0);
+
+    while (vpx_codec_get_frame(&decoder->codec, &iter))
+    {
+    }
+
+    GleedReleasePooledDecoder(codec_type, key, decoder, GleedDestroyVPXCodec);
+}
+
+/*
+    Decoder is recreated when options it was created with change, but only at a keyframe,
+    as a new decoder has no reference frames. Until then the old one keeps decoding.
+*/
+static GleedVPXDecoder *GleedGetVPXDecoder(GleedMovie *movie, GleedMovieCodecType codec_type, GleedVPXDecoder **decoder, Uint64 *decoder_key)
+{
+    VPXContext *ctx = (VPXContext *)movie->vpx_context;
 
-            int vp8_err = vpx_codec_dec_init(&ctx->codec8, ctx->vp8, NULL, 0);
+    const Uint64 key = GleedGetVPXPoolKey(codec_type, &movie->video_decoder_options);
 
-            if (vp8_err != VPX_CODEC_OK)
+    if (*decoder && *decoder_key != key && !ctx->retired_decoder)
+    {
+        const CachedMovieFrame *frame = GleedGetCurrentCachedFrame(movie, GLEED_TRACK_TYPE_VIDEO);
+
+        if (frame && frame->key_frame)
+        {
+            /* Pipelined conversion may still read the held frame, so its decoder must not be reused yet */
+            if (ctx->held_buffer)
             {
-                return GleedSetError("Failed to initialize VP8 decoder: %s", vpx_codec_err_to_string(vp8_err));
+                ctx->retired_decoder = *decoder;
+                ctx->retired_decoder_key = *decoder_key;
+                ctx->retired_decoder_type = codec_type;
             }
+            else
+            {
+                GleedReleaseVPXCodec(codec_type, *decoder, *decoder_key);
+            }
+
+            *decoder = NULL;
+            ctx->last_output_buffer = NULL;
         }
+    }
 
-        vpi = ctx->vp8;
-        codec = &ctx->codec8;
+    if (!*decoder)
+    {
+        *decoder = GleedCreateVPXCodec(codec_type, &movie->video_decoder_options, key);
+        *decoder_key = key;
     }
-    else if (movie->video_codec == GLEED_CODEC_TYPE_VP9)
+
+    return *decoder;
+}
+
+/* Controls which can change at any frame, applied on every decode, so pooled decoders never keep ones of a previous movie */
+static void GleedApplyVPXControls(GleedMovie *movie, GleedVPXDecoder *decoder)
+{
+    const GleedVideoDecoderOptions *options = &movie->video_decoder_options;
+
+    if (movie->video_codec == GLEED_CODEC_TYPE_VP8)
     {
-        if (!ctx->vp9)
+        /* Decoders without postprocessing support reject the control */
+        if (decoder->codec.init_flags & VPX_CODEC_USE_POSTPROC)
         {
-            ctx->vp9 = vpx_codec_vp9_dx();
-
-            int vp9_err = vpx_codec_dec_init(&ctx->codec9, ctx->vp9, NULL, 0);
+            vp8_postproc_cfg_t postproc;
+            postproc.post_proc_flag = options->vp8_postproc ? (VP8_DEBLOCK | VP8_DEMACROBLOCK) : VP8_NOFILTERING;
+            postproc.deblocking_level = SDL_clamp(options->vp8_deblocking_level, 0, 16);
+            postproc.noise_level = 0;
 
-            if (vp9_err != VPX_CODEC_OK)
-            {
-                return GleedSetError("Failed to initialize VP9 decoder: %s", vpx_codec_err_to_string(vp9_err));
-            }
+            vpx_codec_control(&decoder->codec, VP8_SET_POSTPROC, &postproc);
         }
+    }
+    else
+    {
+        vpx_codec_control(&decoder->codec, VP9_SET_SKIP_LOOP_FILTER, options->skip_loop_filter ? 1 : 0);
+    }
+}
+
+bool GleedDecodeVPX(GleedMovie *movie, bool convert)
+{
+    Uint64 decode_start = SDL_GetTicks();
 
-        vpi = ctx->vp9;
-        codec = &ctx->codec9;
+    if (!movie->vpx_context)
+    {
+        movie->vpx_context = SDL_calloc(1, sizeof(VPXContext));
+
+        if (!movie->vpx_context)
+        {
+            return GleedSetError("Failed to allocate memory for VPX context");
+        }
     }
 
-    if (!vpi)
+    GleedVPXDecoder *decoder = NULL;
+
+    VPXContext *ctx = (VPXContext *)movie->vpx_context;
+
+    if (movie->video_codec == GLEED_CODEC_TYPE_VP8)
+    {
+        decoder = GleedGetVPXDecoder(movie, GLEED_CODEC_TYPE_VP8, &ctx->decoder8, &ctx->decoder8_key);
+    }
+    else if (movie->video_codec == GLEED_CODEC_TYPE_VP9)
+    {
+        decoder = GleedGetVPXDecoder(movie, GLEED_CODEC_TYPE_VP9, &ctx->decoder9, &ctx->decoder9_key);
+    }
+    else
     {
         return GleedSetError("Failed to initialize VPX decoder");
     }
 
+    /* Error is already set by GleedCreateVPXCodec */
+    if (!decoder)
+    {
+        return false;
+    }
+
+    vpx_codec_ctx_t *codec = &decoder->codec;
+
+    GleedApplyVPXControls(movie, decoder);
+
     vpx_codec_err_t decode_err = vpx_codec_decode(codec, movie->encoded_video_frame, movie->encoded_video_frame_size, NULL, 0);
 
     if (decode_err != VPX_CODEC_OK)
@@ -123,6 +345,13 @@ bool GleedDecodeVPX(GleedMovie *movie)
         return GleedSetError("Failed to decode VPX frame: %s, %s", vpx_codec_err_to_string(decode_err), vpx_codec_error_detail(codec));
     }
 
+    /* Invisible frames produce no image, decoding them was enough to update references */
+    if (!convert)
+    {
+        movie->last_frame_decode_ms = SDL_GetTicks() - decode_start;
+        return true;
+    }
+
     vpx_codec_iter_t iter = NULL;
 
     vpx_image_t *img = NULL;
@@ -138,116 +367,77 @@ bool GleedDecodeVPX(GleedMovie *movie)
         return GleedSetError("Failed to get decoded VPX frame - received no image");
     }
 
-    if (!movie->current_frame_surface)
-    {
-        movie->current_frame_surface = SDL_CreateSurface(
-            img->d_w,
-            img->d_h,
-            SDL_PIXELFORMAT_RGB24);
-    }
-
-    const SDL_PixelFormatDetails *rgb_format_details = SDL_GetPixelFormatDetails(
-        SDL_PIXELFORMAT_RGB24);
-
-    const SDL_PixelFormatDetails *vpx_format_details = SDL_GetPixelFormatDetails(
-        vpx_format_to_sdl_format(img->fmt));
+    /* Only VP9 images come from our frame buffers */
+    ctx->last_output_buffer = movie->video_codec == GLEED_CODEC_TYPE_VP9 ? (GleedVPXFrameBuffer *)img->fb_priv : NULL;
 
-    SDL_Colorspace vpx_colorspace = vpx_cs_to_sdl_cs(img->cs);
-
-    size_t buffer_size = 0;
+    DecodedVideoFrame frame;
+    frame.width = img->d_w;
+    frame.height = img->d_h;
+    frame.format = vpx_format_to_sdl_format(img->fmt);
+    frame.colorspace = vpx_cs_to_sdl_cs(img->cs);
 
     for (int plane = 0; plane < 3; plane++)
     {
-        buffer_size += vpx_img_plane_height(img, plane) * img->stride[plane];
+        frame.planes[plane] = img->planes[plane];
+        frame.strides[plane] = img->stride[plane];
     }
 
-    if (!movie->conversion_video_frame_buffer)
-    {
-        movie->conversion_video_frame_buffer = (Uint8 *)SDL_calloc(
-            1, buffer_size);
-        movie->conversion_video_frame_buffer_size = buffer_size;
-    }
-    else if (movie->conversion_video_frame_buffer_size < buffer_size)
+    if (!GleedConvertDecodedFrame(movie, &frame))
     {
-        movie->conversion_video_frame_buffer = (Uint8 *)SDL_realloc(
-            movie->conversion_video_frame_buffer, buffer_size);
-        movie->conversion_video_frame_buffer_size = buffer_size;
+        return false;
     }
 
-    Uint8 *convert_buffer = movie->conversion_video_frame_buffer;
-
-    Uint8 *convert_buffer_write_ptr = convert_buffer;
-
-    size_t bytes_copied = 0;
+    movie->last_frame_decode_ms = SDL_GetTicks() - decode_start;
 
-    /* Some hacky conversion from VPX img planes format to SDL continuous buffer with 3 planes*/
-    for (int plane = 0; plane < 3; plane++)
-    {
-        const int plane_height = vpx_img_plane_height(img, plane);
-        const int plane_width = vpx_img_plane_width(img, plane);
-        const int row_size_bytes = img->stride[plane];
+    return true;
+}
 
-        for (int y = 0; y < plane_height; y++)
-        {
-            SDL_memcpy(
-                convert_buffer_write_ptr,
-                img->planes[plane] + y * img->stride[plane],
-                row_size_bytes);
-            convert_buffer_write_ptr += row_size_bytes;
-            bytes_copied += row_size_bytes;
-        }
-    }
+bool GleedHoldVPXFrame(GleedMovie *movie)
+{
+    VPXContext *ctx = (VPXContext *)movie->vpx_context;
 
-    SDL_assert(convert_buffer_write_ptr - convert_buffer == buffer_size);
-    SDL_assert(bytes_copied == buffer_size);
-
-    SDL_LockSurface(movie->current_frame_surface);
-
-    /* Thank you SDL for this monster helper! */
-    if (!SDL_ConvertPixelsAndColorspace(
-            img->d_w,
-            img->d_h,
-            vpx_format_details->format,
-            vpx_colorspace,
-            0,
-            convert_buffer,
-            img->stride[0],
-            rgb_format_details->format,
-            SDL_GetSurfaceColorspace(movie->current_frame_surface),
-            0,
-            movie->current_frame_surface->pixels,
-            movie->current_frame_surface->pitch))
+    /* VP8 frames live in decoder internal buffers, which may be overwritten by the next decode */
+    if (!ctx || !ctx->last_output_buffer)
     {
-        GleedSetError("Failed to convert VPX frame to RGB: %s", SDL_GetError());
-        SDL_free(convert_buffer);
-
         return false;
     }
 
-    SDL_UnlockSurface(movie->current_frame_surface);
+    GleedReleaseVPXFrame(movie);
 
-    movie->last_frame_decode_ms = SDL_GetTicks() - decode_start;
+    ctx->held_buffer = ctx->last_output_buffer;
+    ctx->held_buffer->held = true;
 
     return true;
 }
 
+void GleedReleaseVPXFrame(GleedMovie *movie)
+{
+    VPXContext *ctx = (VPXContext *)movie->vpx_context;
+
+    if (ctx && ctx->held_buffer)
+    {
+        ctx->held_buffer->held = false;
+        ctx->held_buffer = NULL;
+    }
+
+    if (ctx && ctx->retired_decoder)
+    {
+        GleedReleaseVPXCodec(ctx->retired_decoder_type, ctx->retired_decoder, ctx->retired_decoder_key);
+        ctx->retired_decoder = NULL;
+    }
+}
+
 void GleedCloseVPX(GleedMovie *movie)
 {
     if (movie->vpx_context)
     {
         VPXContext *ctx = (VPXContext *)movie->vpx_context;
 
-        if (ctx->vp8)
-        {
-            vpx_codec_destroy(&ctx->codec8);
-            ctx->vp8 = NULL;
-        }
+        /* Pooled decoder must get all of its frame buffers back */
+        GleedReleaseVPXFrame(movie);
 
-        if (ctx->vp9)
-        {
-            vpx_codec_destroy(&ctx->codec9);
-            ctx->vp9 = NULL;
-        }
+        GleedReleaseVPXCodec(GLEED_CODEC_TYPE_VP8, ctx->decoder8, ctx->decoder8_key);
+        GleedReleaseVPXCodec(GLEED_CODEC_TYPE_VP9, ctx->decoder9, ctx->decoder9_key);
 
         SDL_free(ctx);
 
@@ -95,6 +95,9 @@ public:
     GleedMovieWebmCallback(GleedMovie *movie)
     {
         m_movie = movie;
+        m_currentBlockTrack = -1;
+        m_isInKeyFrameBlock = false;
+        m_isInVisibleBlock = true;
     }
 
     webm::Status OnInfo(const webm::ElementMetadata &metadata, const webm::Info &info) override
@@ -123,13 +126,8 @@ public:
                                     const webm::SimpleBlock &simple_block,
                                     webm::Action *action) override
     {
-        if (!simple_block.is_visible)
-        {
-            *action = webm::Action::kSkip;
-            return webm::Status(webm::Status::kOkCompleted);
-        }
-
         m_isInKeyFrameBlock = simple_block.is_key_frame;
+        m_isInVisibleBlock = simple_block.is_visible;
 
         m_currentBlockTrack = GleedFindTrackByNumber(m_movie, simple_block.track_number);
         m_currentBlockTimecode = simple_block.timecode;
@@ -147,18 +145,16 @@ public:
     webm::Status OnBlockBegin(const webm::ElementMetadata &metadata,
                               const webm::Block &block, webm::Action *action) override
     {
-        if (!block.is_visible)
-        {
-            *action = webm::Action::kSkip;
-            return webm::Status(webm::Status::kOkCompleted);
-        }
-
         if (block.num_frames == 0)
         {
             *action = webm::Action::kSkip;
             return webm::Status(webm::Status::kOkCompleted);
         }
 
+        /* Block has no keyframe flag, so it's determined from the frame bitstream */
+        m_isInKeyFrameBlock = false;
+        m_isInVisibleBlock = block.is_visible;
+
         m_currentBlockTrack = GleedFindTrackByNumber(m_movie, block.track_number);
         m_currentBlockTimecode = block.timecode;
         *action = m_currentBlockTrack >= 0 ? webm::Action::kRead : webm::Action::kSkip;
@@ -170,10 +166,35 @@ public:
     {
         if (m_currentBlockTrack != -1)
         {
+            GleedMovieTrack *track = &m_movie->tracks[m_currentBlockTrack];
+
+            bool keyFrame = m_isInKeyFrameBlock;
+
+            /*
+                Block flags are missing for BlockGroups and are often wrong in SimpleBlocks,
+                so for video we peek at the frame header, which tells it reliably.
+            */
+            if (track->type == GLEED_TRACK_TYPE_VIDEO)
+            {
+                Uint8 header[GLEED_KEYFRAME_PEEK_SIZE];
+                std::uint64_t peeked = 0;
+
+                const auto status = reader->Read((std::size_t)SDL_min(*bytes_remaining, sizeof(header)), header, &peeked);
+
+                if (!status.ok())
+                {
+                    return status;
+                }
+
+                *bytes_remaining -= peeked;
+
+                GleedDetectKeyFrame(GleedGetTrackCodec(track), header, (Uint32)peeked, &keyFrame);
+            }
+
             const auto resultingTimecode = m_currentClusterTimecode + m_currentBlockTimecode;
             GleedAddCachedFrame(
                 m_movie,
-                m_currentBlockTrack, resultingTimecode, metadata.position, metadata.size, m_isInKeyFrameBlock);
+                m_currentBlockTrack, resultingTimecode, metadata.position, metadata.size, keyFrame, m_isInVisibleBlock);
         }
 
         return Skip(reader, bytes_remaining);
@@ -200,7 +221,7 @@ public:
             return webm::Status(webm::Status::kOkCompleted);
         }
 
-        if (trackType == webm::TrackType::kVideo && trackCodecId != "V_VP8" && trackCodecId != "V_VP9")
+        if (trackType == webm::TrackType::kVideo && !IsSupportedVideoCodec(trackCodecId))
         {
             return webm::Status(webm::Status::kOkCompleted);
         }
@@ -283,10 +304,22 @@ public:
     }
 
 private:
+    static bool IsSupportedVideoCodec(const std::string &codecId)
+    {
+#ifdef GLEED_ENABLE_AV1
+        if (codecId == "V_AV1")
+        {
+            return true;
+        }
+#endif
+        return codecId == "V_VP8" || codecId == "V_VP9";
+    }
+
     GleedMovie *m_movie;
 
     int m_currentBlockTrack;
     bool m_isInKeyFrameBlock;
+    bool m_isInVisibleBlock;
     Uint64 m_currentBlockTimecode;
     Uint64 m_currentClusterTimecode;
 };
@@ -0,0 +1,327 @@
+#include "gleed_movie_internal.h"
+
+/*
+    Small process-wide pool of threads running batches of independent jobs (e.g. slices of a frame conversion).
+    The calling thread takes jobs too and returns once the whole batch is done.
+
+    Several batches may be queued at once, from different threads or from jobs of another batch
+    (e.g. sliced conversion inside a pipeline stage), and idle workers take jobs of any of them.
+*/
+
+/* Batch lives on the stack of the thread which started it */
+typedef struct GleedJobBatch
+{
+    GleedParallelJobFunc func;
+    void *userdata;
+    int count;                  /**< Number of jobs */
+    int next;                   /**< Index of the next job to take */
+    int remaining;              /**< Number of jobs not finished yet */
+    struct GleedJobBatch *link; /**< Next batch with jobs left to take */
+} GleedJobBatch;
+
+static SDL_SpinLock workers_init_lock = 0; /* Only guards the one-time creation of the sync objects below */
+static bool workers_sync_created = false;
+
+static SDL_Mutex *dispatch_lock = NULL; /* Guards the pool lifecycle, never held while jobs run or threads are joined */
+static SDL_Condition *batch_ended = NULL; /* Also signaled when a resize is done */
+static bool workers_started = false;
+static bool workers_resizing = false; /* Batches started meanwhile run serially */
+static int running_batches = 0;
+static int configured_worker_threads = 0;
+
+static SDL_Thread *worker_threads[GLEED_MAX_WORKER_THREADS];
+static int worker_threads_count = 0;
+
+static SDL_Mutex *jobs_lock = NULL; /* Guards the batch state below */
+static SDL_Condition *jobs_available = NULL;
+static SDL_Condition *jobs_finished = NULL;
+
+static GleedJobBatch *pending_batches = NULL; /* Newest first, so jobs of nested batches are taken before the outer ones */
+static bool workers_quit = false;
+
+/* Takes and runs one job of the batch, which must have jobs left to take. jobs_lock must be held */
+static void GleedRunJob(GleedJobBatch *batch)
+{
+    const int index = batch->next++;
+
+    if (batch->next == batch->count)
+    {
+        GleedJobBatch **link = &pending_batches;
+
+        while (*link != batch)
+        {
+            link = &(*link)->link;
+        }
+
+        *link = batch->link;
+    }
+
+    SDL_UnlockMutex(jobs_lock);
+
+    batch->func(batch->userdata, index);
+
+    SDL_LockMutex(jobs_lock);
+
+    /* Several callers may be waiting for their own batches */
+    if (--batch->remaining == 0)
+    {
+        SDL_BroadcastCondition(jobs_finished);
+    }
+}
+
+static int SDLCALL GleedWorkerThread(void *data)
+{
+    SDL_LockMutex(jobs_lock);
+
+    while (!workers_quit)
+    {
+        if (pending_batches)
+        {
+            GleedRunJob(pending_batches);
+        }
+        else
+        {
+            SDL_WaitCondition(jobs_available, jobs_lock);
+        }
+    }
+
+    SDL_UnlockMutex(jobs_lock);
+
+    return 0;
+}
+
+/* Sync objects live as long as the process, so threads racing a resize never see them destroyed */
+static bool GleedCreateWorkersSync(void)
+{
+    SDL_LockSpinlock(&workers_init_lock);
+
+    if (!workers_sync_created)
+    {
+        dispatch_lock = SDL_CreateMutex();
+        batch_ended = SDL_CreateCondition();
+        jobs_lock = SDL_CreateMutex();
+        jobs_available = SDL_CreateCondition();
+        jobs_finished = SDL_CreateCondition();
+
+        workers_sync_created = dispatch_lock && batch_ended && jobs_lock && jobs_available && jobs_finished;
+
+        if (!workers_sync_created)
+        {
+            SDL_DestroyCondition(jobs_finished);
+            SDL_DestroyCondition(jobs_available);
+            SDL_DestroyMutex(jobs_lock);
+            SDL_DestroyCondition(batch_ended);
+            SDL_DestroyMutex(dispatch_lock);
+
+            jobs_finished = NULL;
+            jobs_available = NULL;
+            jobs_lock = NULL;
+            batch_ended = NULL;
+            dispatch_lock = NULL;
+        }
+    }
+
+    const bool created = workers_sync_created;
+
+    SDL_UnlockSpinlock(&workers_init_lock);
+
+    return created;
+}
+
+/* Threads are started on first use, so applications which never convert large frames don't pay for them. dispatch_lock must be held */
+static void GleedStartWorkers(void)
+{
+    if (workers_started)
+    {
+        return;
+    }
+
+    workers_started = true;
+
+    /* Calling thread is a worker too */
+    int threads = configured_worker_threads > 0 ? configured_worker_threads - 1 : SDL_GetNumLogicalCPUCores() - 1;
+    threads = SDL_clamp(threads, 0, GLEED_MAX_WORKER_THREADS);
+
+    for (int i = 0; i < threads; i++)
+    {
+        worker_threads[worker_threads_count] = SDL_CreateThread(GleedWorkerThread, "GleedWorker", NULL);
+
+        /* Fewer threads are still better than none, and with none jobs are just run serially */
+        if (!worker_threads[worker_threads_count])
+            break;
+
+        worker_threads_count++;
+    }
+}
+
+/* Joins threads taken out of the pool, no batch may be running. dispatch_lock must not be held, joining may take a while */
+static void GleedStopWorkers(SDL_Thread **threads, int count)
+{
+    SDL_LockMutex(jobs_lock);
+    workers_quit = true;
+    SDL_BroadcastCondition(jobs_available);
+    SDL_UnlockMutex(jobs_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    SDL_LockMutex(jobs_lock);
+    workers_quit = false;
+    SDL_UnlockMutex(jobs_lock);
+}
+
+/* Claims the workers for a batch, false if its jobs should run serially */
+static bool GleedBeginBatch(void)
+{
+    if (!GleedCreateWorkersSync())
+    {
+        return false;
+    }
+
+    SDL_LockMutex(dispatch_lock);
+
+    bool claimed = false;
+
+    if (!workers_resizing)
+    {
+        GleedStartWorkers();
+
+        claimed = worker_threads_count > 0;
+        running_batches += claimed;
+    }
+
+    SDL_UnlockMutex(dispatch_lock);
+
+    return claimed;
+}
+
+static void GleedEndBatch(void)
+{
+    SDL_LockMutex(dispatch_lock);
+
+    if (--running_batches == 0)
+    {
+        SDL_BroadcastCondition(batch_ended);
+    }
+
+    SDL_UnlockMutex(dispatch_lock);
+}
+
+int GleedGetParallelism(void)
+{
+    if (!GleedCreateWorkersSync())
+    {
+        return 1;
+    }
+
+    SDL_LockMutex(dispatch_lock);
+
+    if (!workers_resizing)
+    {
+        GleedStartWorkers();
+    }
+
+    const int parallelism = worker_threads_count + 1;
+
+    SDL_UnlockMutex(dispatch_lock);
+
+    return parallelism;
+}
+
+void GleedRunParallel(GleedParallelJobFunc func, void *userdata, int count)
+{
+    if (count <= 1 || !GleedBeginBatch())
+    {
+        for (int i = 0; i < count; i++)
+        {
+            func(userdata, i);
+        }
+        return;
+    }
+
+    GleedJobBatch batch;
+    batch.func = func;
+    batch.userdata = userdata;
+    batch.count = count;
+    batch.next = 0;
+    batch.remaining = count;
+
+    SDL_LockMutex(jobs_lock);
+
+    batch.link = pending_batches;
+    pending_batches = &batch;
+
+    SDL_BroadcastCondition(jobs_available);
+
+    /*
+        Calling thread only takes jobs of its own batch, so it returns as soon as the batch is done.
+        Jobs taken by others never wait for this thread, so waiting for them can't deadlock.
+    */
+    while (batch.next < batch.count)
+    {
+        GleedRunJob(&batch);
+    }
+
+    while (batch.remaining > 0)
+    {
+        SDL_WaitCondition(jobs_finished, jobs_lock);
+    }
+
+    SDL_UnlockMutex(jobs_lock);
+
+    GleedEndBatch();
+}
+
+bool GleedSetConversionThreads(int count)
+{
+    if (count < 0)
+    {
+        return GleedSetError("Conversion thread count cannot be negative");
+    }
+
+    if (!GleedCreateWorkersSync())
+    {
+        return GleedSetError("Failed to create conversion worker locks: %s", SDL_GetError());
+    }
+
+    SDL_LockMutex(dispatch_lock);
+
+    /* Concurrent resizes take turns */
+    while (workers_resizing)
+    {
+        SDL_WaitCondition(batch_ended, dispatch_lock);
+    }
+
+    /* Running batches are let to finish, and new ones run serially until the workers are replaced */
+    workers_resizing = true;
+
+    while (running_batches > 0)
+    {
+        SDL_WaitCondition(batch_ended, dispatch_lock);
+    }
+
+    /* Threads are taken out of the pool, so other threads see no workers while they are joined */
+    SDL_Thread *threads[GLEED_MAX_WORKER_THREADS];
+    const int threads_count = worker_threads_count;
+
+    SDL_memcpy(threads, worker_threads, threads_count * sizeof(SDL_Thread *));
+    worker_threads_count = 0;
+    workers_started = false;
+
+    SDL_UnlockMutex(dispatch_lock);
+
+    GleedStopWorkers(threads, threads_count);
+
+    SDL_LockMutex(dispatch_lock);
+
+    configured_worker_threads = count;
+    workers_resizing = false;
+
+    SDL_BroadcastCondition(batch_ended);
+
+    SDL_UnlockMutex(dispatch_lock);
+
+    return true;
+}
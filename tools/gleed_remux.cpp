@@ -0,0 +1,54 @@
+/*
+    Gleed remux tool
+
+    Rewrites a WebM file for fast runtime use, without re-encoding:
+    Cues are placed at the front of the file, every Cluster starts at a video keyframe
+    and keyframe flags are taken from the codec bitstream.
+
+    Only the first video and audio tracks are kept, as these are the ones Gleed selects by default.
+
+    Usage: gleed_remux <input.webm> <output.webm>
+*/
+
+#include <iostream>
+#include <SDL3/SDL.h>
+
+#include <gleed.h>
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.webm> <output.webm>" << std::endl;
+        return 1;
+    }
+
+    GleedMovie *movie = GleedOpen(argv[1]);
+
+    if (!movie)
+    {
+        std::cerr << GleedGetError() << std::endl;
+        return 1;
+    }
+
+    SDL_IOStream *output = SDL_IOFromFile(argv[2], "w+b");
+
+    if (!output)
+    {
+        std::cerr << "Failed to open output file: " << SDL_GetError() << std::endl;
+        GleedFreeMovie(movie, true);
+        return 1;
+    }
+
+    const bool remuxed = GleedRemuxForPlayback(movie, output);
+
+    if (!remuxed)
+    {
+        std::cerr << GleedGetError() << std::endl;
+    }
+
+    SDL_CloseIO(output);
+    GleedFreeMovie(movie, true);
+
+    return remuxed ? 0 : 1;
+}